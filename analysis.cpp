@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <stdlib.h>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "analysis.hpp"
+
+using std::vector;
+using Complex = std::complex<float>;
+
+static const constexpr double PI              = 3.14159265358979323846;
+static const constexpr double BANDWIDTH_FLOOR = 1e-5; // energy above the bandwidth, -50 dB of the total
+static const constexpr double LOWPASS_MARGIN  = 0.9;  // lame's lowpass sits below Nyquist
+
+// speech votes, see isSpeech()
+static const constexpr double SPEECH_LOW_ENERGY = 0.25; // pauses between words
+static const constexpr double SPEECH_ZCR_SPREAD = 0.6;  // voiced vs unvoiced sounds, drums too
+static const constexpr double SPEECH_FLUX       = 0.4;  // syllables change the spectrum all the time
+
+
+int32_t maxChannelDifference(int16_t const* stereo, int32_t frames)
+{
+    int32_t maxDiff = 0;
+    int32_t frame   = 0;
+
+#if defined (__SSE2__)
+    // 4 frames at a time: swap L and R inside every pair of lanes and take
+    // saturated |a - b| both ways, saturation keeps 32767 as "very different"
+    __m128i vMax = _mm_setzero_si128();
+
+    for (; frame + 4 <= frames; frame += 4) {
+        auto const v       = _mm_loadu_si128(reinterpret_cast<__m128i const*>(stereo + frame * 2));
+        auto const swapped = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        auto const diff    = _mm_max_epi16(_mm_subs_epi16(v, swapped), _mm_subs_epi16(swapped, v));
+        vMax = _mm_max_epi16(vMax, diff);
+    }
+
+    alignas(16) int16_t lanes[8];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), vMax);
+    maxDiff = *std::max_element(lanes, lanes + 8);
+#endif
+
+    for (; frame < frames; ++frame)
+        maxDiff = std::max(maxDiff, ::abs(stereo[frame * 2] - stereo[frame * 2 + 1]));
+
+    return std::min(maxDiff, 32767); // same scale as the SIMD path
+}
+
+
+int32_t maxAbsSample(int16_t const* samples, int32_t count)
+{
+    int32_t maxAbs = 0;
+    int32_t idx    = 0;
+
+#if defined (__SSE2__)
+    auto const zero = _mm_setzero_si128();
+    __m128i    vMax = zero;
+
+    for (; idx + 8 <= count; idx += 8) {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(samples + idx));
+        vMax = _mm_max_epi16(vMax, _mm_max_epi16(v, _mm_subs_epi16(zero, v)));
+    }
+
+    alignas(16) int16_t lanes[8];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), vMax);
+    maxAbs = *std::max_element(lanes, lanes + 8);
+#endif
+
+    for (; idx < count; ++idx)
+        maxAbs = std::max(maxAbs, ::abs(static_cast<int32_t>(samples[idx])));
+
+    return std::min(maxAbs, 32767);
+}
+
+
+// in place iterative radix-2 FFT, size is a power of 2
+static void fft(vector<Complex>& data)
+{
+    auto const size = data.size();
+
+    for (size_t idx = 1, rev = 0; idx < size; ++idx) {
+        auto bit = size >> 1;
+        for (; rev & bit; bit >>= 1)
+            rev ^= bit;
+        rev ^= bit;
+
+        if (idx < rev)
+            std::swap(data[idx], data[rev]);
+    }
+
+    for (size_t len = 2; len <= size; len <<= 1) {
+        auto const step = std::polar(1.0f, static_cast<float>(-2 * PI / len));
+
+        for (size_t first = 0; first < size; first += len) {
+            Complex twiddle = 1;
+
+            for (size_t idx = 0; idx < len / 2; ++idx, twiddle *= step) {
+                auto const even = data[first + idx];
+                auto const odd  = data[first + idx + len / 2] * twiddle;
+                data[first + idx]           = even + odd;
+                data[first + idx + len / 2] = even - odd;
+            }
+        }
+    }
+}
+
+
+// FFT of Hann windowed samples, bins has the window size
+static void hannSpectrum(int16_t const* samples, vector<Complex>& bins)
+{
+    auto const size = bins.size();
+
+    for (size_t idx = 0; idx < size; ++idx) {
+        auto const hann = 0.5f - 0.5f * static_cast<float>(std::cos(2 * PI * idx / (size - 1)));
+        bins[idx] = Complex(samples[idx] * hann, 0);
+    }
+
+    fft(bins);
+}
+
+
+// Hann windowed power spectrum averaged over all windows, bins 0 .. windowFrames / 2
+static vector<double> averageSpectrum(int16_t const* mono, int32_t windowFrames, int32_t windowNum)
+{
+    vector<double>  power(windowFrames / 2 + 1, 0.0);
+    vector<Complex> bins(windowFrames);
+
+    for (int32_t window = 0; window < windowNum; ++window) {
+        hannSpectrum(mono + window * windowFrames, bins);
+
+        for (size_t bin = 0; bin < power.size(); ++bin)
+            power[bin] += std::norm(bins[bin]);
+    }
+
+    return power;
+}
+
+
+double estimateBandwidth(int16_t const* mono, int32_t windowFrames, int32_t windowNum, int32_t sampleRate)
+{
+    auto const power = averageSpectrum(mono, windowFrames, windowNum);
+    double     total = 0;
+
+    for (size_t bin = 1; bin < power.size(); ++bin) // no DC
+        total += power[bin];
+
+    if (total <= 0)
+        return 0; // silence has no bandwidth
+
+    double above = 0;
+    auto   bin   = power.size() - 1;
+
+    for (; bin > 1 && above + power[bin] <= total * BANDWIDTH_FLOOR; --bin)
+        above += power[bin];
+
+    return static_cast<double>(bin) * sampleRate / windowFrames;
+}
+
+
+int32_t pickOutSampleRate(double bandwidth, int32_t inRate)
+{
+    int32_t const rates[] = { 8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000 };
+
+    if (bandwidth <= 0) // silence, nothing to go by
+        return 0;
+
+    for (auto const rate : rates) {
+        if (rate >= inRate)
+            break;
+
+        if (rate / 2 * LOWPASS_MARGIN >= bandwidth)
+            return rate;
+    }
+
+    return 0;
+}
+
+
+ContentFeatures measureContent(int16_t const* mono, int32_t windowFrames, int32_t windowNum, int32_t frameSize)
+{
+    auto const      frameNum = windowFrames / frameSize * windowNum;
+    vector<double>  rms(frameNum), zcr(frameNum);
+    vector<double>  spectrum(frameSize / 2 + 1), previous(spectrum.size());
+    vector<Complex> bins(frameSize);
+    double          fluxSum  = 0;
+    int32_t         fluxNum  = 0;
+    ContentFeatures features = {};
+
+    for (int32_t frame = 0; frame < frameNum; ++frame) {
+        auto const samples   = mono + frame * frameSize;
+        double     energy    = 0;
+        int32_t    crossings = 0;
+
+        for (int32_t idx = 0; idx < frameSize; ++idx) {
+            energy += static_cast<double>(samples[idx]) * samples[idx];
+            crossings += idx > 0 && (samples[idx] < 0) != (samples[idx - 1] < 0) ? 1 : 0;
+        }
+
+        rms[frame] = std::sqrt(energy / frameSize);
+        zcr[frame] = static_cast<double>(crossings) / frameSize;
+
+        hannSpectrum(samples, bins);
+        double total = 0;
+
+        for (size_t bin = 0; bin < spectrum.size(); ++bin)
+            total += spectrum[bin] = std::abs(bins[bin]);
+
+        for (auto& magnitude : spectrum) // shape only, loudness changes aren't flux
+            magnitude = total > 0 ? magnitude / total : 0;
+
+        if (frame % (windowFrames / frameSize) > 0) { // frames of a window are back to back, windows aren't
+            double flux = 0;
+            for (size_t bin = 0; bin < spectrum.size(); ++bin)
+                flux += std::abs(spectrum[bin] - previous[bin]);
+
+            fluxSum += flux;
+            ++fluxNum;
+        }
+
+        spectrum.swap(previous);
+    }
+
+    double meanRms = 0, meanZcr = 0, zcrVariance = 0;
+
+    for (int32_t frame = 0; frame < frameNum; ++frame) {
+        meanRms += rms[frame] / frameNum;
+        meanZcr += zcr[frame] / frameNum;
+    }
+
+    for (int32_t frame = 0; frame < frameNum; ++frame) {
+        features.lowEnergyRatio += rms[frame] < meanRms / 2 ? 1.0 / frameNum : 0;
+        zcrVariance += (zcr[frame] - meanZcr) * (zcr[frame] - meanZcr) / frameNum;
+    }
+
+    features.zcrSpread    = meanZcr > 0 ? std::sqrt(zcrVariance) / meanZcr : 0;
+    features.spectralFlux = fluxNum > 0 ? fluxSum / fluxNum : 0;
+    return features;
+}
+
+
+bool isSpeech(ContentFeatures const& features)
+{
+    return features.lowEnergyRatio > SPEECH_LOW_ENERGY // percussive music passes the other two
+        && (features.zcrSpread > SPEECH_ZCR_SPREAD || features.spectralFlux > SPEECH_FLUX);
+}
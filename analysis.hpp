@@ -0,0 +1,33 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <stdint.h>
+
+// largest |L - R| over interleaved stereo frames, 0 for dual mono
+int32_t maxChannelDifference(int16_t const* stereo, int32_t frames);
+
+// largest |sample| over any samples, -32768 counts as 32767
+int32_t maxAbsSample(int16_t const* samples, int32_t count);
+
+// frequency in Hz below which nearly all energy of the mono windows lies,
+// windows are windowFrames long and back to back in mono, windowFrames is a power of 2
+double estimateBandwidth(int16_t const* mono, int32_t windowFrames, int32_t windowNum, int32_t sampleRate);
+
+// lowest MPEG sample rate keeping bandwidth, 0 if it wouldn't be lower than inRate
+int32_t pickOutSampleRate(double bandwidth, int32_t inRate);
+
+// features telling speech from music, measured on short frames of the mono windows
+struct ContentFeatures
+{
+    double lowEnergyRatio; // share of frames quieter than half the mean RMS
+    double zcrSpread;      // standard deviation / mean of zero crossing rates of the frames
+    double spectralFlux;   // mean change of the normalized spectrum between adjacent frames, 0 .. 2
+};
+
+// frameSize is a power of 2 dividing windowFrames
+ContentFeatures measureContent(int16_t const* mono, int32_t windowFrames, int32_t windowNum, int32_t frameSize);
+
+// pauses like between words and either of the other features looks like speech
+bool isSpeech(ContentFeatures const& features);
+
+#endif // ANALYSIS_H
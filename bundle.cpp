@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "bundle.hpp"
+#include "throttle.hpp"
+
+using std::string;
+
+static const constexpr char     BUNDLE_MAGIC[4] = { 'E', '2', 'M', 'B' };
+static const constexpr uint32_t BUNDLE_VERSION  = 1;
+
+
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+
+Bundle::~Bundle()
+{
+    if (data)
+        ::munmap(const_cast<uint8_t*>(data), size);
+}
+
+
+bool Bundle::load(string const& fileName, string& error)
+{
+    auto const fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+
+    if (fd < 0 || ::fstat(fd, &info) != 0) {
+        error = "Can't open bundle";
+        if (fd >= 0)
+            ::close(fd);
+        return false;
+    }
+
+    size = static_cast<size_t>(info.st_size);
+    void* addr = size >= sizeof(BundleHeader) ? ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd); // the mapping stays
+
+    if (addr == MAP_FAILED) {
+        error = size < sizeof(BundleHeader) ? "Not a bundle" : string("mmap failed: ") + ::strerror(errno);
+        return false;
+    }
+
+    data = static_cast<uint8_t const*>(addr);
+    return true;
+}
+
+#else // no mmap(), the whole file is read in
+
+Bundle::~Bundle() {}
+
+
+bool Bundle::load(string const& fileName, string& error)
+{
+    std::ifstream file(fileName, std::ios_base::binary | std::ios_base::ate);
+
+    if (!file) {
+        error = "Can't open bundle";
+        return false;
+    }
+
+    copy.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(copy.data()), static_cast<std::streamsize>(copy.size()));
+
+    if (!file) {
+        error = "Can't read bundle";
+        return false;
+    }
+    if (copy.size() < sizeof(BundleHeader)) {
+        error = "Not a bundle";
+        return false;
+    }
+
+    data = copy.data();
+    size = copy.size();
+    return true;
+}
+
+#endif
+
+
+bool Bundle::open(string const& fileName, string& error)
+{
+    if (!load(fileName, error))
+        return false;
+
+    BundleHeader header;
+    ::memcpy(&header, data, sizeof(header));
+
+    if (::memcmp(header.magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0 || header.version != BUNDLE_VERSION) {
+        error = "Not a bundle";
+        return false;
+    }
+
+    index.reserve(static_cast<size_t>(std::min<uint64_t>(header.clipNum, size / sizeof(BundleEntry))));
+
+    for (uint64_t pos = header.indexOffset; index.size() < header.clipNum;) { // every field checked, bytes come from a file
+        BundleEntry entry;
+
+        if (pos > size || size - pos < sizeof(entry)) {
+            error = "Broken bundle index";
+            return false;
+        }
+
+        ::memcpy(&entry, data + pos, sizeof(entry));
+        pos += sizeof(entry);
+
+        if (size - pos < entry.nameSize || entry.offset > size || size - entry.offset < entry.bytes || entry.offset % 2 != 0) {
+            error = "Broken bundle index";
+            return false;
+        }
+
+        index.push_back({ string(reinterpret_cast<char const*>(data + pos), entry.nameSize), entry.offset, entry.bytes,
+                          entry.sampleRate, entry.channels, entry.format });
+        pos += entry.nameSize;
+    }
+
+    return true;
+}
+
+
+std::shared_ptr<Bundle const> openBundle(string const& fileName, string& error)
+{
+    static pthread_mutex_t                               mtx = PTHREAD_MUTEX_INITIALIZER;
+    static std::map<string, std::weak_ptr<Bundle const>> bundles; // unmapped with the last holder
+
+    ::pthread_mutex_lock(&mtx);
+    auto& cached = bundles[fileName];
+    auto  bundle = cached.lock();
+
+    if (!bundle) {
+        auto opened = std::make_shared<Bundle>();
+        if (opened->open(fileName, error))
+            bundle = opened;
+        cached = bundle;
+    }
+
+    for (auto it = bundles.begin(); it != bundles.end();) // names of bundles no longer held
+        it = it->second.expired() ? bundles.erase(it) : std::next(it);
+
+    ::pthread_mutex_unlock(&mtx);
+    return bundle;
+}
+
+
+bool isBundleName(string const& fileName)
+{
+    auto const dotPos = fileName.find_last_of('.');
+    return dotPos != string::npos && ::strcasecmp(fileName.c_str() + dotPos, ".e2mb") == 0;
+}
+
+
+bool BundleWriter::open(string const& fileName, string& error)
+{
+    this->fileName = fileName;
+    file.open(fileName + ".part", std::ios_base::binary | std::ofstream::out | std::ofstream::trunc);
+    BundleHeader header = {}; // written again by close()
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    if (!file)
+        error = "Can't write bundle";
+    return static_cast<bool>(file);
+}
+
+
+void BundleWriter::addClip(string const& name, int32_t sampleRate, int32_t channels)
+{
+    index.push_back({ name.substr(0, UINT16_MAX), position, 0, sampleRate, static_cast<uint16_t>(channels), BUNDLE_PCM16 });
+}
+
+
+void BundleWriter::write(int16_t const* frames, int32_t frameNum)
+{
+    auto const bytes = static_cast<size_t>(frameNum) * index.back().channels * sizeof(int16_t);
+
+    throttleWrite(bytes);
+    file.write(reinterpret_cast<char const*>(frames), static_cast<std::streamsize>(bytes));
+    index.back().bytes += bytes;
+    position           += bytes;
+}
+
+
+bool BundleWriter::close(string& error)
+{
+    BundleHeader header = { {}, BUNDLE_VERSION, index.size(), position };
+    ::memcpy(header.magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC));
+
+    for (auto const& clip : index) {
+        BundleEntry const entry = { clip.offset, clip.bytes, clip.sampleRate, clip.channels, clip.format, static_cast<uint16_t>(clip.name.size()) };
+        file.write(reinterpret_cast<char const*>(&entry), sizeof(entry));
+        file.write(clip.name.data(), static_cast<std::streamsize>(clip.name.size()));
+    }
+
+    file.seekp(0);
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    file.close();
+
+    auto const partName = fileName + ".part";
+#if !(defined (__linux__) || defined (__linux) || defined (__gnu_linux__))
+    ::remove(fileName.c_str()); // Windows doesn't rename over a file
+#endif
+    bool const isOk = file && ::rename(partName.c_str(), fileName.c_str()) == 0; // a mapped older bundle is never truncated
+
+    if (!isOk) {
+        ::remove(partName.c_str());
+        error = "Can't write bundle";
+    }
+    return isOk;
+}
@@ -0,0 +1,91 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// many short clips in one file, so a batch of them costs one open instead of one each:
+// a header, the PCM of all clips back to back and the index of the clips at the end,
+// all little endian; written by --pack, read by mapping the whole file (or
+// reading it in where there is no mmap())
+#pragma pack(push, 1)
+struct BundleHeader
+{
+    char     magic[4];    // "E2MB"
+    uint32_t version;
+    uint64_t clipNum;
+    uint64_t indexOffset; // the index is written after the PCM
+};
+
+// index entry, followed by nameSize bytes of the name
+struct BundleEntry
+{
+    uint64_t offset;      // PCM from the start of the file
+    uint64_t bytes;
+    int32_t  sampleRate;
+    uint16_t channels;
+    uint16_t format;      // BUNDLE_PCM16 only
+    uint16_t nameSize;
+};
+#pragma pack (pop)
+
+static const constexpr uint16_t BUNDLE_PCM16 = 1; // interleaved 16 bit, as WAV's audioFormat 1
+
+struct BundleClip
+{
+    std::string name;       // path relative to the packed folder
+    uint64_t    offset;
+    uint64_t    bytes;
+    int32_t     sampleRate;
+    uint16_t    channels;
+    uint16_t    format;
+};
+
+class Bundle
+{
+public:
+    Bundle() = default;
+    ~Bundle();
+
+    Bundle(Bundle const&) = delete;
+    Bundle& operator=(Bundle const&) = delete;
+
+    bool open(std::string const& fileName, std::string& error);
+
+    std::vector<BundleClip> const& clips() const { return index; }
+    uint8_t const*                 pcm(BundleClip const& clip) const { return data + clip.offset; }
+
+private:
+    bool load(std::string const& fileName, std::string& error); // sets data and size
+
+    uint8_t const*          data = nullptr; // whole file
+    size_t                  size = 0;
+    std::vector<uint8_t>    copy;           // of the file where it can't be mapped
+    std::vector<BundleClip> index;
+};
+
+// bundle mapped once while anyone holds it and shared by all jobs of its clips, null
+// with error set on failure; encodeJobs() holds the bundles of its jobs for the batch
+std::shared_ptr<Bundle const> openBundle(std::string const& fileName, std::string& error);
+bool isBundleName(std::string const& fileName); // name.e2mb
+
+class BundleWriter
+{
+public:
+    bool open(std::string const& fileName, std::string& error);
+    void addClip(std::string const& name, int32_t sampleRate, int32_t channels); // write() goes to it
+    void write(int16_t const* frames, int32_t frameNum);
+    bool close(std::string& error); // writes the index and the header, then renames name.part to name
+
+private:
+    std::string             fileName;
+    std::ofstream           file;     // name.part, so mappings of an older name stay whole
+    std::vector<BundleClip> index;
+    uint64_t                position = sizeof(BundleHeader);
+};
+
+#endif // BUNDLE_H
@@ -0,0 +1,132 @@
+#include <string.h>
+
+#include "checksum.hpp"
+
+static const constexpr uint32_t CRC32C_POLY = 0x82f63b78; // reflected 0x1edc6f41
+
+
+namespace
+{
+struct Crc32cTable
+{
+    uint32_t entries[8][256];
+
+    // slicing-by-8 tables
+    Crc32cTable()
+    {
+        for (uint32_t byte = 0; byte < 256; ++byte) {
+            uint32_t crc = byte;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1)));
+            entries[0][byte] = crc;
+        }
+
+        for (uint32_t byte = 0; byte < 256; ++byte)
+            for (int slice = 1; slice < 8; ++slice)
+                entries[slice][byte] = (entries[slice - 1][byte] >> 8) ^ entries[0][entries[slice - 1][byte] & 0xff];
+    }
+};
+}
+
+
+static uint32_t crc32cPortable(uint32_t crc, uint8_t const* data, size_t size)
+{
+    static Crc32cTable const table; // thread safe init
+    auto const& t = table.entries;
+
+    for (; size >= 8; size -= 8, data += 8) {
+        uint32_t low  = 0;
+        uint32_t high = 0;
+        ::memcpy(&low,  data,     4); // little endian only, as the rest of the PCM code
+        ::memcpy(&high, data + 4, 4);
+        low ^= crc;
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24]
+            ^ t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^ t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+    }
+
+    while (size--)
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+
+    return crc;
+}
+
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#include <nmmintrin.h>
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSse42(uint32_t crc, uint8_t const* data, size_t size)
+{
+#if defined (__x86_64__)
+    uint64_t crc64 = crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        uint64_t word = 0;
+        ::memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+
+    while (size--)
+        crc = _mm_crc32_u8(crc, *data++);
+
+    return crc;
+}
+
+
+static bool hasSse42()
+{
+    static bool const has = __builtin_cpu_supports("sse4.2");
+    return has;
+}
+#else
+static uint32_t crc32cSse42(uint32_t crc, uint8_t const* data, size_t size)
+{
+    return crc32cPortable(crc, data, size);
+}
+
+
+static bool hasSse42()
+{
+    return false;
+}
+#endif
+
+
+// a * b modulo the CRC polynomial, bit reflected as the CRC is
+static uint32_t multModPoly(uint32_t a, uint32_t b)
+{
+    uint32_t product = 0;
+
+    for (uint32_t bit = 1u << 31; a != 0; bit >>= 1) {
+        if (a & bit) {
+            product ^= b;
+            a       ^= bit;
+        }
+        b = (b >> 1) ^ (CRC32C_POLY & (0u - (b & 1)));
+    }
+
+    return product;
+}
+
+
+uint32_t crc32c_combine(uint32_t crcA, uint32_t crcB, uint64_t sizeB)
+{
+    uint32_t shift  = 1u << 31; // x^0
+    uint32_t square = 1u << 23; // x^8, one byte
+
+    for (; sizeB != 0; sizeB >>= 1, square = multModPoly(square, square)) // x^(8 * sizeB) by squaring
+        if (sizeB & 1)
+            shift = multModPoly(square, shift);
+
+    return multModPoly(shift, crcA) ^ crcB;
+}
+
+
+uint32_t crc32c(uint32_t crc, void const* data, size_t size)
+{
+    auto const bytes = static_cast<uint8_t const*>(data);
+    crc = ~crc;
+    crc = hasSse42() ? crc32cSse42(crc, bytes, size) : crc32cPortable(crc, bytes, size);
+    return ~crc;
+}
@@ -0,0 +1,15 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC32C (Castagnoli), continue from a previous value or start from 0,
+// uses SSE4.2 crc32 instruction when the CPU has one
+uint32_t crc32c(uint32_t crc, void const* data, size_t size);
+
+// CRC32C of A followed by B from crc32c() of each and the size of B, as zlib's
+// crc32_combine(); CRCs are linear, so it also swaps a part of known CRC for another
+uint32_t crc32c_combine(uint32_t crcA, uint32_t crcB, uint64_t sizeB);
+
+#endif // CHECKSUM_H
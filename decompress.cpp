@@ -0,0 +1,432 @@
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <string.h>
+
+#include "decompress.hpp"
+#include "pool.hpp"
+#include "throttle.hpp"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using std::string;
+using std::vector;
+
+static const constexpr size_t INPUT_SIZE   = 64 * 1024;  // compressed bytes read at once
+static const constexpr size_t CHUNK_SIZE   = 256 * 1024; // decoded bytes handed over at once
+static const constexpr size_t QUEUE_CHUNKS = 4;          // decoded ahead of the reader at most
+
+
+Compression detectCompression(uint8_t const* magic, size_t size)
+{
+    if (size >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+        return Compression::Gzip;
+    if (size >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+        return Compression::Zstd;
+    return Compression::None;
+}
+
+
+bool isCompressionAvailable(Compression compression)
+{
+    switch (compression) {
+#ifdef HAVE_ZLIB
+    case Compression::Gzip:
+        return true;
+#endif
+#ifdef HAVE_ZSTD
+    case Compression::Zstd:
+        return true;
+#endif
+    default:
+        return compression == Compression::None;
+    }
+}
+
+
+char const* compressionName(Compression compression)
+{
+    return compression == Compression::Gzip ? "gzip" : compression == Compression::Zstd ? "zstd" : "none";
+}
+
+
+vector<string> withCompressedExtentions(vector<string> const& extentions)
+{
+    auto all = extentions;
+
+    for (auto const& extention : extentions) {
+        if (isCompressionAvailable(Compression::Gzip))
+            all.push_back(extention + ".gz");
+        if (isCompressionAvailable(Compression::Zstd))
+            all.push_back(extention + ".zst");
+    }
+
+    return all;
+}
+
+
+string stripCompressedExtention(string const& fileName)
+{
+    auto lower = fileName.substr(fileName.size() - std::min<size_t>(fileName.size(), 4));
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return ::tolower(c); });
+
+    if (lower.size() == 4 && lower.compare(1, 3, ".gz") == 0)
+        return fileName.substr(0, fileName.size() - 3);
+    if (lower == ".zst")
+        return fileName.substr(0, fileName.size() - 4);
+    return fileName;
+}
+
+
+// everything the decoder touches; whoever sets isDecoding runs the codec,
+// the rest is guarded by mtx
+struct DecodeState
+{
+    ~DecodeState();
+
+    std::ifstream                    file;
+    Compression                      compression  = Compression::None;
+    std::vector<uint8_t>             input        = std::vector<uint8_t>(INPUT_SIZE);
+    std::vector<uint8_t>             output       = std::vector<uint8_t>(CHUNK_SIZE);
+    bool                             isFull       = false; // the codec may have more output without more input
+    bool                             isAtEnd      = false; // at the end of a gzip member or zstd frame
+#ifdef HAVE_ZLIB
+    z_stream                         zs           = {};
+    int                              zStatus      = Z_OK;
+    bool                             isZlib       = false; // zs initialized
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DStream*                    zstd         = nullptr;
+    ZSTD_inBuffer                    in           = {};
+#endif
+    Executor*                        executor     = nullptr;
+    std::deque<std::vector<uint8_t>> chunks;               // decoded, not read yet
+    bool                             isDecoding   = false;
+    bool                             isPumpQueued = false; // a task is submitted and hasn't started yet
+    bool                             isEnd        = false;
+    bool                             isCorrupt    = false;
+    bool                             isClosed     = false; // reader is gone
+    pthread_mutex_t                  mtx          = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t                   cnd          = PTHREAD_COND_INITIALIZER;
+};
+
+
+DecodeState::~DecodeState()
+{
+#ifdef HAVE_ZLIB
+    if (isZlib)
+        ::inflateEnd(&zs);
+#endif
+#ifdef HAVE_ZSTD
+    ::ZSTD_freeDStream(zstd);
+#endif
+    ::pthread_cond_destroy(&cnd);
+    ::pthread_mutex_destroy(&mtx);
+}
+
+
+// next block of the compressed file, false at its end
+static bool readInput(std::ifstream& file, vector<uint8_t>& input, size_t& size)
+{
+    throttleRead(input.size());
+    file.read(reinterpret_cast<char*>(input.data()), static_cast<std::streamsize>(input.size()));
+    size = static_cast<size_t>(file.gcount());
+    return size > 0;
+}
+
+
+// up to a chunk of output decoded into state.output, false at the end
+// of the file or on a corrupt stream
+static bool inflateStep(DecodeState& state, size_t& size)
+{
+#ifdef HAVE_ZLIB
+    auto& zs = state.zs;
+
+    for (;;) {
+        if (zs.avail_in == 0 && !state.isFull) {
+            size_t got = 0;
+            if (!readInput(state.file, state.input, got))
+                return false;
+
+            zs.next_in  = state.input.data();
+            zs.avail_in = static_cast<uInt>(got);
+        }
+
+        if (state.zStatus == Z_STREAM_END && zs.avail_in > 0) { // members of a concatenated file, as gzip -d reads them
+            ::inflateReset(&zs);
+            state.zStatus = Z_OK;
+        }
+
+        zs.next_out   = state.output.data();
+        zs.avail_out  = static_cast<uInt>(state.output.size());
+        state.zStatus = ::inflate(&zs, Z_NO_FLUSH);
+
+        if (state.zStatus == Z_BUF_ERROR && zs.avail_in == 0) { // output ended with the input, the rest needs more of it
+            state.zStatus = Z_OK;
+            state.isFull  = false;
+            continue;
+        }
+
+        state.isAtEnd = state.zStatus == Z_STREAM_END;
+
+        if (state.zStatus != Z_OK && state.zStatus != Z_STREAM_END)
+            return false;
+
+        state.isFull = zs.avail_out == 0;
+        size         = state.output.size() - zs.avail_out;
+        return true;
+    }
+#else
+    (void)state;
+    (void)size;
+    return false;
+#endif
+}
+
+
+static bool unzstdStep(DecodeState& state, size_t& size)
+{
+#ifdef HAVE_ZSTD
+    auto& in = state.in;
+
+    if (in.pos == in.size && !state.isFull) {
+        size_t got = 0;
+        if (!readInput(state.file, state.input, got))
+            return false;
+
+        in = ZSTD_inBuffer{ state.input.data(), got, 0 };
+    }
+
+    auto       out    = ZSTD_outBuffer{ state.output.data(), state.output.size(), 0 };
+    auto const status = ::ZSTD_decompressStream(state.zstd, &out, &in); // runs on into the next frame by itself
+
+    if (::ZSTD_isError(status)) {
+        state.isAtEnd = false;
+        return false;
+    }
+
+    state.isAtEnd = status == 0;
+    state.isFull  = out.pos == out.size;
+    size          = out.pos;
+    return true;
+#else
+    (void)state;
+    (void)size;
+    return false;
+#endif
+}
+
+
+// the decoder for the caller if no one has it and the queue has room, under mtx
+static bool takeDecoding(DecodeState& state)
+{
+    if (state.isDecoding || state.isEnd || state.isClosed || state.chunks.size() >= QUEUE_CHUNKS)
+        return false;
+
+    state.isDecoding = true;
+    return true;
+}
+
+
+// one step of the decoder taken with takeDecoding(), outside of mtx
+static void decodeStep(DecodeState& state)
+{
+    size_t     size   = 0;
+    bool const isMore = state.compression == Compression::Gzip ? inflateStep(state, size) : unzstdStep(state, size);
+
+    ::pthread_mutex_lock(&state.mtx);
+
+    if (size > 0 && !state.isClosed)
+        state.chunks.emplace_back(state.output.data(), state.output.data() + size);
+
+    if (!isMore) {
+        state.isEnd     = true;
+        state.isCorrupt = !state.isAtEnd && !state.isClosed;
+    }
+
+    state.isDecoding = false;
+    ::pthread_cond_broadcast(&state.cnd); // a chunk for the reader, the decoder for the others
+    ::pthread_mutex_unlock(&state.mtx);
+}
+
+
+// decoder thread without an executor, the stream joins it before the state goes
+static void* decodeThread(void* arg)
+{
+    auto& state = *static_cast<DecodeState*>(arg);
+
+    ::pthread_mutex_lock(&state.mtx);
+
+    while (!state.isEnd && !state.isClosed) {
+        if (!takeDecoding(state)) {
+            ::pthread_cond_wait(&state.cnd, &state.mtx);
+            continue;
+        }
+
+        ::pthread_mutex_unlock(&state.mtx);
+        decodeStep(state);
+        ::pthread_mutex_lock(&state.mtx);
+    }
+
+    ::pthread_mutex_unlock(&state.mtx);
+    return nullptr;
+}
+
+
+// decoder task on the executor, fills the queue and returns; may start after the stream is gone
+static void pumpTask(void* arg)
+{
+    auto const ref   = static_cast<std::shared_ptr<DecodeState>*>(arg);
+    auto const state = std::move(*ref);
+    delete ref;
+
+    ::pthread_mutex_lock(&state->mtx);
+    state->isPumpQueued = false;
+
+    while (takeDecoding(*state)) {
+        ::pthread_mutex_unlock(&state->mtx);
+        decodeStep(*state);
+        ::pthread_mutex_lock(&state->mtx);
+    }
+
+    ::pthread_mutex_unlock(&state->mtx);
+}
+
+
+// another decoder task unless one is waiting to start, under mtx; submit it after unlocking
+static bool queuePump(DecodeState& state)
+{
+    if (!state.executor || state.isPumpQueued || state.isEnd || state.isClosed)
+        return false;
+
+    state.isPumpQueued = true;
+    return true;
+}
+
+
+DecompressStream::~DecompressStream()
+{
+    if (!state)
+        return;
+
+    ::pthread_mutex_lock(&state->mtx);
+    state->isClosed = true; // a decoder waiting for room gives up, queued tasks do nothing
+    ::pthread_cond_broadcast(&state->cnd);
+    ::pthread_mutex_unlock(&state->mtx);
+
+    if (isStarted)
+        ::pthread_join(thread, nullptr);
+}
+
+
+bool DecompressStream::open(string const& fileName, Compression kind, string& error)
+{
+    if (!isCompressionAvailable(kind)) {
+        error = string("Can't read ") + compressionName(kind) + " input, built without " + (kind == Compression::Gzip ? "zlib" : "libzstd");
+        return false;
+    }
+
+    auto opened = std::make_shared<DecodeState>();
+    opened->file.open(fileName, std::ios_base::binary | std::ifstream::in);
+
+    if (!opened->file) {
+        error = "Can't open file";
+        return false;
+    }
+
+    bool isReady = false;
+#ifdef HAVE_ZLIB
+    if (kind == Compression::Gzip)
+        isReady = opened->isZlib = ::inflateInit2(&opened->zs, 15 + 16) == Z_OK; // 16 - gzip wrapper
+#endif
+#ifdef HAVE_ZSTD
+    if (kind == Compression::Zstd) {
+        opened->zstd = ::ZSTD_createDStream();
+        isReady      = opened->zstd && !::ZSTD_isError(::ZSTD_initDStream(opened->zstd));
+    }
+#endif
+
+    if (!isReady) {
+        error = string("Can't start ") + compressionName(kind) + " decoder";
+        return false;
+    }
+
+    opened->compression = kind;
+    opened->executor    = getExecutor();
+    state               = opened;
+
+    if (state->executor) {
+        state->isPumpQueued = true;
+        state->executor->submit(&pumpTask, new std::shared_ptr<DecodeState>(state));
+        return true;
+    }
+
+    isStarted = ::pthread_create(&thread, nullptr, &decodeThread, state.get()) == 0;
+
+    if (!isStarted)
+        error = "Can't start decompression thread";
+
+    return isStarted;
+}
+
+
+size_t DecompressStream::read(void* data, size_t size)
+{
+    auto   out  = static_cast<uint8_t*>(data);
+    size_t done = 0;
+
+    while (done < size) {
+        if (currentPos == current.size()) {
+            ::pthread_mutex_lock(&state->mtx);
+
+            while (state->chunks.empty() && !state->isEnd) {
+                if (takeDecoding(*state)) { // no one is at it, maybe all host threads are busy
+                    ::pthread_mutex_unlock(&state->mtx);
+                    decodeStep(*state);
+                    ::pthread_mutex_lock(&state->mtx);
+                    continue;
+                }
+
+                ::pthread_cond_wait(&state->cnd, &state->mtx);
+            }
+
+            if (state->chunks.empty()) {
+                ::pthread_mutex_unlock(&state->mtx);
+                break;
+            }
+
+            current = std::move(state->chunks.front());
+            state->chunks.pop_front();
+            currentPos = 0;
+            ::pthread_cond_broadcast(&state->cnd); // room for the decoder
+
+            bool const isPump = queuePump(*state);
+            ::pthread_mutex_unlock(&state->mtx);
+
+            if (isPump)
+                state->executor->submit(&pumpTask, new std::shared_ptr<DecodeState>(state));
+        }
+
+        auto const toCopy = std::min(size - done, current.size() - currentPos);
+        ::memcpy(out + done, current.data() + currentPos, toCopy);
+        currentPos += toCopy;
+        done       += toCopy;
+    }
+
+    return done;
+}
+
+
+bool DecompressStream::isBroken() const
+{
+    ::pthread_mutex_lock(&state->mtx);
+    bool const isBrokenNow = state->isCorrupt;
+    ::pthread_mutex_unlock(&state->mtx);
+    return isBrokenNow;
+}
@@ -0,0 +1,59 @@
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+enum class Compression
+{
+    None,
+    Gzip, // needs zlib, HAVE_ZLIB
+    Zstd  // needs libzstd, HAVE_ZSTD
+};
+
+// compression of a file by its first bytes, None for anything else
+Compression detectCompression(uint8_t const* magic, size_t size);
+bool        isCompressionAvailable(Compression compression);
+char const* compressionName(Compression compression);
+
+// extentions plus their .gz and .zst variants the build can read
+std::vector<std::string> withCompressedExtentions(std::vector<std::string> const& extentions);
+
+// name without a trailing .gz or .zst, other names as they are
+std::string stripCompressedExtention(std::string const& fileName);
+
+struct DecodeState; // decoder and the chunks it hands over, kept alive by tasks still queued
+
+// decompressed contents of a gzip or zstd file, decoded a few chunks ahead of the
+// reader by a thread of its own, or by tasks on the Executor when one is set (see
+// pool.hpp); the reader decodes itself when it would wait for a task that hasn't
+// started yet. Nothing is written anywhere
+class DecompressStream
+{
+public:
+    DecompressStream() = default;
+    ~DecompressStream();
+
+    DecompressStream(DecompressStream const&) = delete;
+    DecompressStream& operator=(DecompressStream const&) = delete;
+
+    bool open(std::string const& fileName, Compression compression, std::string& error);
+
+    // up to size bytes, fewer only at the end of the data or of a corrupt stream
+    size_t read(void* data, size_t size);
+
+    bool isBroken() const; // the stream ended on an error, not at its end
+
+private:
+    std::shared_ptr<DecodeState> state;
+    pthread_t                    thread;
+    bool                         isStarted  = false; // thread, without an executor
+    std::vector<uint8_t>         current;            // chunk being read
+    size_t                       currentPos = 0;
+};
+
+#endif // DECOMPRESS_H
@@ -12,19 +12,42 @@
 //   (9) the LAME encoder should be used with reasonable standard settings (e.g. quality based encoding with quality level "good")
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
 #include <iostream>  // standard C++
+#include <limits>
 #include <fstream>
+#include <memory>
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <assert.h>
+#include <stdio.h>
 #include <string.h>  // standard C
 #include <errno.h>
 #include <pthread.h> // POSIX
 
-#include <lame/lame.h>
-
+#include "analysis.hpp"
+#include "bundle.hpp"
+#include "checksum.hpp"
+#include "decompress.hpp"
 #include "encode2mp3.hpp"
+#include "encoder.hpp"
 #include "filesystem.hpp"
+#include "hls.hpp"
+#include "hosttokens.hpp"
+#include "mp3frame.hpp"
+#include "options.hpp"
+#include "peaks.hpp"
+#include "pool.hpp"
+#include "procpool.hpp"
+#include "seekindex.hpp"
+#include "shmring.hpp"
+#include "source.hpp"
+#include "split.hpp"
+#include "throttle.hpp"
 
 using std::vector;
 using std::string;
@@ -32,43 +55,33 @@ using std::cout;
 using std::cerr;
 using std::endl;
 
-static pthread_mutex_t consoleMtx;
-static vector<string> extentions = { "wav", "wave", "pcm" }; // lower case
-
+static const constexpr int32_t DEFAULT_BITRATE = 128;  // lame's CBR default, kbps
+static const constexpr size_t  PCM_BUF_SIZE    = 8192; // L+R channels of 16 bits each
+static const constexpr size_t  MP3_BUF_SIZE    = 8192; // bytes
 
-// read PCM file into PcmHeader structure
-static PcmHeader readPcmHeader(std::ifstream& pcm)
-{
-    PcmHeader pcmHeader;
-    static_assert(sizeof(PcmHeader) == 44, "Wrong PCM header structure!");
-    pcm.read(reinterpret_cast<char*>(&pcmHeader), sizeof(PcmHeader));
-    return pcmHeader;
-}
+static pthread_mutex_t consoleMtx;
+static bool isQuiet = false; // no per file progress messages
+static vector<string> extentions = withCompressedExtentions({ "wav", "wave", "pcm" }); // lower case
 
 
-// check if PCM header contains required data
-static bool isValid(PcmHeader const& h)
+static bool endsWith(string const& text, string const& suffix)
 {
-    return h.audioFormat   == 1
-        && h.bitsPerSample == 16 // transforming 8 bit to 16 resulting in an awful quality mp3
-        && h.numChannels    > 0
-        && h.sampleRate     > 0
-        && h.bitsPerSample  > 0
-        && ::memcmp(h.subchunk2ID, "data", 4) == 0;
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
 }
 
 
-// test lame functions for success or throw with details
-static void okOrThrow(int32_t status, int line)
+static bool isMp3Name(string fileName)
 {
-    if (status != lame_errorcodes_t::LAME_OKAY)
-        throw std::runtime_error("ERROR: lame failed with code " + std::to_string(status) + " at line " + std::to_string(line));
+    std::transform(fileName.begin(), fileName.end(), fileName.begin(), [](char c) { return ::tolower(c); });
+    return endsWith(fileName, ".mp3");
 }
 
 
-// replace file extention with "mp3"
+// replace file extention with "mp3", name.wav.gz becomes name.mp3
 static string changeExtention(string fileName)
 {
+    fileName = stripCompressedExtention(fileName);
+
     while (fileName.back() != '.')
         fileName.pop_back();
 
@@ -77,160 +90,1143 @@ static string changeExtention(string fileName)
 }
 
 
-// thread worker: 1 file - 1 worker
-// sadly, lame doesn't support multithread encoding for a singlle file...
-static void* encode2mp3Worker(void* file)
+// output name for a job, transcoded MP3s get the bitrate in the name
+// so they don't overwrite their sources
+static string makeOutFileName(string const& inFileName, Options const& options)
 {
-    if (!file) {
-        cerr << "ERROR! File path is NULL!\n";
-        return nullptr;
+    if (isShmInput(inFileName)) {
+        string shmName;
+        string outFileName;
+        parseShmInput(inFileName, shmName, outFileName);
+        return outFileName;
     }
 
-    auto    inFileName       = static_cast<char const*>(file);
-    auto    outFileName      = changeExtention(inFileName);
-    auto    inPcm            = std::ifstream(inFileName, std::ifstream::in);
-    auto    pcmHeader        = readPcmHeader(inPcm);
-    int64_t samplesDeclared  = pcmHeader.subchunk2Size / pcmHeader.blockAlign;
+    auto outFileName = changeExtention(inFileName);
+
+    if (!isMp3Name(inFileName))
+        return outFileName;
+
+    outFileName.resize(outFileName.size() - 3);
+    return outFileName + std::to_string(options.bitrate > 0 ? options.bitrate : DEFAULT_BITRATE) + "k.mp3";
+}
+
+
+// where the encoded stream goes: one MP3 file or HLS segments
+struct Mp3Out
+{
+    std::ofstream                     file;
+    std::unique_ptr<HlsSegmenter>     segments;
+    std::unique_ptr<SeekIndexBuilder> index; // of whichever of the two
+    std::vector<uint8_t>              head;  // first bytes of the stream, where the Info tag placeholder would be
+    bool                              isTagFirst = false; // the stream starts with the encoder's placeholder
+};
+
+
+// write encoded bytes keeping the output size and checksum up to date
+static void writeMp3(Mp3Out& out, uint8_t const* data, int32_t size, JobResult& result, Options const& options)
+{
+    if (size > 0)
+        throttleWrite(static_cast<size_t>(size));
+
+    if (out.segments)
+        out.segments->write(data, static_cast<size_t>(size)); // errors show at finish()
+    else
+        out.file.write(reinterpret_cast<char const*>(data), size);
+
+    if (out.index) // data is still in cache, no reading back
+        out.index->add(data, static_cast<size_t>(size));
+
+    const constexpr size_t HEAD_SIZE = 1441; // the largest layer III frame, lame's tag placeholder is in there
+    if (out.head.size() < HEAD_SIZE && size > 0)
+        out.head.insert(out.head.end(), data, data + std::min<size_t>(HEAD_SIZE - out.head.size(), size));
+    result.mp3Bytes += static_cast<uint64_t>(size);
+
+    if (options.isManifest)
+        result.mp3Crc = crc32c(result.mp3Crc, data, static_cast<size_t>(size));
+}
+
+
+// put the encoder's final Info tag (length, gapless padding) over the placeholder
+// frame it started the stream with, plain MP3 files only, segments are long gone;
+// pieces and silent frames have no placeholder, their first frame may be zeros too;
+// the MP3 checksum follows without reading the file back
+static void writeTag(Mp3Out& out, Mp3Encoder& encoder, JobResult& result, Options const& options)
+{
+    auto         tag     = vector<uint8_t>(MP3_BUF_SIZE, 0);
+    auto const   tagSize = encoder.tag(tag.data(), tag.size());
+    Mp3FrameInfo info;
+
+    if (!out.isTagFirst || tagSize == 0 || !out.file.is_open() || out.head.size() < 4 || !parseMp3FrameHeader(out.head.data(), info)
+        || static_cast<size_t>(info.size) != tagSize || !isTagPlaceholderFrame(out.head.data(), out.head.size(), info))
+        return;
+
+    out.file.seekp(0);
+    out.file.write(reinterpret_cast<char const*>(tag.data()), static_cast<std::streamsize>(tagSize));
+    out.file.seekp(0, std::ios_base::end);
+
+    if (options.isManifest) // the placeholder's share of the running CRC swapped for the tag's
+        result.mp3Crc = crc32c_combine(crc32c(0, tag.data(), tagSize) ^ crc32c(0, out.head.data(), tagSize), result.mp3Crc,
+                                       result.mp3Bytes - tagSize);
+}
+
+
+// the encoder failed (e.g. its output buffer overflowed): the partial MP3 file
+// goes, the job is reported and not counted as encoded
+static void dropFailedOutput(Mp3Out& out, string const& mp3FileName, char const* inFileName)
+{
+    if (out.file.is_open()) {
+        out.file.close();
+        ::remove(mp3FileName.c_str());
+    }
 
     ::pthread_mutex_lock(&consoleMtx);
+    cerr << "ERROR! Encoder failed: " << inFileName << endl;
+    ::pthread_mutex_unlock(&consoleMtx);
+}
 
-    if (!isValid(pcmHeader)) {
-        if (pcmHeader.audioFormat != 1)
-            cerr << "ERROR! Unsupported audio format: " << inFileName << endl; // cmd.exe swallows "\n"s sometimes
-        else if (pcmHeader.bitsPerSample != 16)
-            cerr << "ERROR! Only 16 bit per sample is supported: " << inFileName << endl;
-        else
-            cerr << "ERROR! Broken header: " << inFileName << endl;
 
+// write silent frames for the duration of the input instead of encoding it,
+// false if MPEG has no such sample rate
+static bool writeSilence(Mp3Out& out, int32_t sampleRate, int32_t channels, int64_t samples,
+                         JobResult& result, Options const& options)
+{
+    auto const   frame = makeSilentMp3Frame(sampleRate, channels);
+    Mp3FrameInfo info;
+
+    if (frame.empty() || !parseMp3FrameHeader(frame.data(), info))
+        return false;
+
+    out.isTagFirst = false; // instead of the encoder's frames, nothing is written yet
+    if (out.segments)
+        out.segments->setTagFirst(false);
+    if (out.index)
+        out.index->setTagFirst(false);
+
+    for (int64_t written = 0; written < samples; written += info.samples)
+        writeMp3(out, frame.data(), static_cast<int32_t>(frame.size()), result, options);
+
+    return true;
+}
+
+
+// mono mix of windowNum windows spread evenly over the source, rewinds it afterwards,
+// false for streams and files shorter than a window
+static bool readWindows(PcmSource& source, int32_t windowFrames, int32_t windowNum, vector<int16_t>& mono)
+{
+    if (source.frames < windowFrames || !source.seek(0))
+        return false;
+
+    auto frames = vector<int16_t>(static_cast<size_t>(windowFrames) * source.channels);
+    mono.assign(static_cast<size_t>(windowFrames) * windowNum, 0);
+
+    for (int32_t window = 0; window < windowNum; ++window) {
+        auto const first = (source.frames - windowFrames) * (window + 1) / (windowNum + 1);
+
+        if (!source.seek(first) || source.read(frames.data(), windowFrames) != windowFrames)
+            return false;
+
+        for (int32_t frame = 0; frame < windowFrames; ++frame) {
+            int32_t sum = 0;
+            for (int32_t channel = 0; channel < source.channels; ++channel)
+                sum += frames[frame * source.channels + channel];
+            mono[window * windowFrames + frame] = static_cast<int16_t>(sum / source.channels);
+        }
+    }
+
+    return source.seek(0);
+}
+
+
+// encoder settings of one file: the speech or music preset, the output sample rate
+// from the measured bandwidth unless the preset has one
+static Preset choosePreset(PcmSource& source, char const* inFileName, Options const& options, bool& isSpeechFile)
+{
+    const constexpr int32_t WINDOW_FRAMES = 4096;
+    const constexpr int32_t WINDOW_NUM    = 16;
+
+    Preset          preset    = options.musicPreset;
+    double          bandwidth = -1;
+    vector<int16_t> mono;
+
+    isSpeechFile = false;
+
+    if (!(options.isAutoSampleRate || options.isClassify) || !readWindows(source, WINDOW_FRAMES, WINDOW_NUM, mono))
+        return preset;
+
+    if (options.isClassify) {
+        auto const frameSize = source.sampleRate >= 32000 ? 1024 : 512; // some 20 ms
+        isSpeechFile = isSpeech(measureContent(mono.data(), WINDOW_FRAMES, WINDOW_NUM, frameSize));
+        preset       = isSpeechFile ? options.speechPreset : options.musicPreset;
+    }
+
+    if (preset.sampleRate >= source.sampleRate) // no upsampling
+        preset.sampleRate = 0;
+
+    if (options.isAutoSampleRate && preset.sampleRate == 0) {
+        bandwidth         = estimateBandwidth(mono.data(), WINDOW_FRAMES, WINDOW_NUM, source.sampleRate);
+        preset.sampleRate = pickOutSampleRate(bandwidth, source.sampleRate);
+    }
+
+    if (!isQuiet) {
+        ::pthread_mutex_lock(&consoleMtx);
+        if (options.isClassify)
+            cout << (isSpeechFile ? "Speech, " : "Music, ");
+        if (bandwidth >= 0)
+            cout << "bandwidth " << static_cast<int32_t>(bandwidth) << " Hz, ";
+        cout << "output sample rate " << (preset.sampleRate > 0 ? preset.sampleRate : source.sampleRate) << ": " << inFileName << endl;
+        ::pthread_mutex_unlock(&consoleMtx);
+    }
+
+    return preset;
+}
+
+
+// input of a job: the file or the time range of it
+static std::unique_ptr<PcmSource> openJobSource(Job const& job, Options const& options, string& error)
+{
+    auto source = job.clip >= 0 ? openClipSource(job.name, static_cast<size_t>(job.clip), error)
+                                : openSource(job.name, options.isTranscode, error, options.isFollow ? options.followTimeout : 0);
+
+    if (source && (job.start > 0 || job.end > 0)) { // rounded to the nearest frame
+        auto const sampleRate = source->sampleRate;
+        source = limitSource(std::move(source), std::llround(job.start * sampleRate), job.end > 0 ? std::llround(job.end * sampleRate) : -1);
+    }
+
+    return source;
+}
+
+
+// encoder settings of a file or of a piece of it, see --split
+static EncoderSettings makeSettings(int32_t channels, int32_t sampleRate, Preset const& preset, Options const& options, bool isMono, bool isPiece)
+{
+    EncoderSettings settings;
+    settings.channels      = channels;
+    settings.inSampleRate  = sampleRate;
+    settings.outSampleRate = preset.sampleRate;
+    settings.bitrate       = preset.bitrate > 0 ? preset.bitrate : options.bitrate;
+    settings.quality       = preset.quality >= 0 ? preset.quality : 5;
+    settings.isMono        = isMono;
+    settings.isPiece       = isPiece;
+    return settings;
+}
+
+
+struct SplitBatch
+{
+    Job const*              job;
+    Options const*          options;
+    Preset                  preset;
+    bool                    isMono;
+    vector<SplitPiece>      pieces;
+    vector<vector<uint8_t>> mp3;  // trimmed MP3 frames of every piece
+    vector<uint8_t>         isOk; // not vector<bool>, pieces finish on different threads
+};
+
+
+// pool job of --split: 1 piece of a file - 1 job, each with its own source and encoder
+static void encodePiece(size_t pieceIdx, void* ctx)
+{
+    auto&       batch = *static_cast<SplitBatch*>(ctx);
+    auto const& piece = batch.pieces[pieceIdx];
+    string      error;
+    auto        source = openJobSource(*batch.job, *batch.options, error);
+
+    if (!source)
+        return;
+
+    source = limitSource(std::move(source), piece.readFirst, piece.readEnd);
+
+    auto const encoder = makeEncoder(batch.job->encoder, makeSettings(source->channels, source->sampleRate, batch.preset, *batch.options, batch.isMono, true), error);
+
+    if (!encoder)
+        return;
+
+    acquireHostToken(); // a piece is a job of its own for --host-cpus
+
+    auto            pcmBuffer = vector<int16_t>(PCM_BUF_SIZE, 0);
+    auto            mp3Buffer = vector<uint8_t>(MP3_BUF_SIZE, 0);
+    int32_t const   maxFrames = static_cast<int32_t>(PCM_BUF_SIZE) / source->channels;
+    int16_t const*  pcm       = nullptr;
+    vector<uint8_t> mp3;
+
+    int32_t         toWrite   = 0;
+
+    for (int32_t samplesRead; toWrite >= 0 && (samplesRead = source->acquire(pcm, pcmBuffer.data(), maxFrames)) > 0;) {
+        toWrite = encoder->encode(pcm, samplesRead, mp3Buffer.data(), MP3_BUF_SIZE);
+        mp3.insert(mp3.end(), mp3Buffer.begin(), mp3Buffer.begin() + std::max(0, toWrite));
+        addPoolProgress(static_cast<double>(samplesRead) / source->sampleRate);
+    }
+
+    if (toWrite >= 0)
+        toWrite = encoder->flush(mp3Buffer.data(), MP3_BUF_SIZE);
+    releaseHostToken();
+
+    if (toWrite < 0) // encoder error, the piece and so the file fail
+        return;
+
+    mp3.insert(mp3.end(), mp3Buffer.begin(), mp3Buffer.begin() + toWrite);
+
+    batch.mp3[pieceIdx]  = trimFrames(mp3, piece.dropFrames, piece.keepFrames);
+    batch.isOk[pieceIdx] = 1;
+}
+
+
+// encode a whole seekable source in up to options.splitNum pieces at once,
+// false if any of them fails
+static bool encodePieces(Job const& job, Options const& options, Preset const& preset, bool isMono,
+                         int32_t frameSamples, int64_t samples, vector<vector<uint8_t>>& mp3)
+{
+    SplitBatch batch = { &job, &options, preset, isMono, planSplit(samples, frameSamples, options.splitNum), {}, {} };
+
+    batch.mp3.resize(batch.pieces.size());
+    batch.isOk.assign(batch.pieces.size(), 0);
+    releaseHostToken(); // only waits meanwhile, the pieces need the tokens
+    auto const stats = runPool(batch.pieces.size(), batch.pieces.size(), &encodePiece, &batch, options.isBackground);
+    acquireHostToken();
+
+    if (stats.isPriorityKept) {
+        ::pthread_mutex_lock(&consoleMtx);
+        cerr << "WARNING: can't lower worker priority" << endl;
+        ::pthread_mutex_unlock(&consoleMtx);
+    }
+
+    if (std::find(batch.isOk.begin(), batch.isOk.end(), 0) != batch.isOk.end())
+        return false;
+
+    mp3 = std::move(batch.mp3);
+    return true;
+}
+
+
+// what a job writes as far as the summary and the manifest go: the MP3 or the HLS playlist
+static string makeJobOutFileName(Job const& job, Options const& options)
+{
+    auto const mp3FileName = job.outName.empty() ? makeOutFileName(job.name, options) : job.outName;
+    return options.hlsSegmentSeconds > 0 ? mp3FileName.substr(0, mp3FileName.size() - 4) + ".hls/playlist.m3u8" : mp3FileName;
+}
+
+
+// pieces encoded at once are joined by frames, which needs a known length,
+// seeking, no resampling and frames free of the bit reservoir, only lame
+// can do without it; checks of the first chunk have to be off.
+// What keeps a file from --split, nullptr if nothing does
+static char const* findSplitBlocker(Job const& job, Options const& options, PcmSource& source, Mp3Encoder const& encoder,
+                                    bool isDualMonoAllowed, bool isSilenceAllowed)
+{
+    if (job.encoder != EncoderKind::Lame)
+        return "the fast encoder can't turn its bit reservoir off";
+    if (isDualMonoAllowed)
+        return "--dual-mono checks the whole file in order";
+    if (isSilenceAllowed)
+        return "--silence checks the whole file in order";
+    if (options.peakSamples > 0)
+        return "--peaks reads the file in order";
+    if (options.isManifest)
+        return "--manifest checksums the PCM in order";
+    if (source.frames <= 0)
+        return "the length is unknown";
+    if (encoder.outSampleRate() != source.sampleRate)
+        return "it is resampled";
+    if (!source.seek(0))
+        return "it can't seek";
+    return nullptr;
+}
+
+
+// encode one file, stereo files which start as dual mono are encoded as mono
+// and silent files become silent frames or nothing if allowed, the result
+// tells if a file has to be encoded again because it turned out not to be so
+static JobResult encodeFileWith(Job const& job, Options const& options, bool isDualMonoAllowed, bool isSilenceAllowed)
+{
+    JobResult result;
+    string    error;
+
+    auto const inFileName  = job.name.c_str();
+    auto const mp3FileName = job.outName.empty() ? makeOutFileName(inFileName, options) : job.outName;
+    auto const hlsDir      = options.hlsSegmentSeconds > 0 ? mp3FileName.substr(0, mp3FileName.size() - 4) + ".hls" : string();
+    auto const outFileName = makeJobOutFileName(job, options);
+    auto       source      = openJobSource(job, options, error);
+
+    ::pthread_mutex_lock(&consoleMtx);
+
+    if (!source) {
+        cerr << "ERROR! " << error << ": " << inFileName << endl; // cmd.exe swallows "\n"s sometimes
         ::pthread_mutex_unlock(&consoleMtx);
-        inPcm.close();
-        return nullptr;
+        return result;
     }
 
-    cout << "Encoding file to " << outFileName << "\n" << "Number of samples: " << samplesDeclared << endl;
+    if (!isQuiet) {
+        cout << "Encoding file to " << outFileName << "\n" << "Number of samples: ";
+        if (source->frames >= 0)
+            cout << source->frames << endl;
+        else
+            cout << "unknown" << endl;
+    }
     ::pthread_mutex_unlock(&consoleMtx);
 
-    lame_t pLameGF = lame_init();
-    bool const isMono = pcmHeader.numChannels == 1;
+    bool       isSpeechFile = false;
+    auto const preset       = choosePreset(*source, inFileName, options, isSpeechFile); // before the first read
+
+    auto           pcmBuffer   = vector<int16_t>(PCM_BUF_SIZE, 0); // vector fills itself at construction by default
+    int32_t const  maxFrames   = static_cast<int32_t>(PCM_BUF_SIZE) / source->channels;
+    int16_t const* pcm         = nullptr; // either pcmBuffer or PCM in the source's own memory
+    auto           samplesRead = source->acquire(pcm, pcmBuffer.data(), maxFrames); // first chunk is looked at before encoding
+
+    bool const isDownmix = preset.isMono && source->channels == 2;
 
-    try {
-        okOrThrow(::lame_set_mode         (pLameGF, isMono ? MONO : STEREO), __LINE__);
-        okOrThrow(::lame_set_in_samplerate(pLameGF, pcmHeader.sampleRate),   __LINE__);
-        okOrThrow(::lame_set_VBR          (pLameGF, vbr_off),                __LINE__); // keep it off, affects resulting mp3 length somehow
-        okOrThrow(::lame_set_quality      (pLameGF, 5),                      __LINE__);
-        okOrThrow(::lame_init_params      (pLameGF),                         __LINE__);
+    result.isSpeech   = isSpeechFile;
+    result.isDualMono = !isDownmix && isDualMonoAllowed && source->channels == 2 && samplesRead > 0
+                     && maxChannelDifference(pcm, samplesRead) <= options.dualMonoThreshold;
+
+    bool const isMono  = source->channels == 1 || isDownmix || result.isDualMono; // the encoder downmixes stereo
+    auto const encoder = makeEncoder(job.encoder, makeSettings(source->channels, source->sampleRate, preset, options, isMono, false), error);
+
+    if (!encoder) {
+        ::pthread_mutex_lock(&consoleMtx);
+        cerr << "ERROR! " << error << ": " << inFileName << endl;
+        ::pthread_mutex_unlock(&consoleMtx);
+        return result;
     }
-    catch (std::runtime_error const& e) {
+
+    vector<vector<uint8_t>> pieceMp3;
+    auto const splitBlocker = options.splitNum > 1 ? findSplitBlocker(job, options, *source, *encoder, isDualMonoAllowed, isSilenceAllowed)
+                                                   : nullptr;
+    bool const isSplit      = options.splitNum > 1 && !splitBlocker;
+    bool const isTagFirst   = !isSplit && job.encoder == EncoderKind::Lame; // lame starts with its Info tag placeholder, pieces don't
+
+    if (splitBlocker) {
         ::pthread_mutex_lock(&consoleMtx);
-        cerr << e.what() << endl;
+        cerr << "WARNING: not split, " << splitBlocker << ": " << inFileName << endl;
         ::pthread_mutex_unlock(&consoleMtx);
-        ::lame_close(pLameGF);
-        inPcm.close();
-        return nullptr;
     }
 
-    const constexpr size_t PCM_BUF_SIZE = 8192; // L+R channels of 16 bits each
-    const constexpr size_t MP3_BUF_SIZE = 8192; // bytes
+    if (isSplit) {
+        if (!encodePieces(job, options, preset, isMono, encoder->frameSamples(), source->frames, pieceMp3)) {
+            ::pthread_mutex_lock(&consoleMtx);
+            cerr << "ERROR! Can't encode pieces of " << inFileName << endl;
+            ::pthread_mutex_unlock(&consoleMtx);
+            return result;
+        }
+
+        samplesRead = 0; // the pieces read for themselves
+    }
+
+    auto    mp3Buffer        = vector<uint8_t>(MP3_BUF_SIZE, 0); // element's value, so make it explicit
+    Mp3Out  out;
+    int32_t toWrite          = 0;
+    int64_t samplesReadTotal = 0;
+    bool    isSilentSoFar    = isSilenceAllowed; // silent chunks are held back until the end or a sound
+    std::unique_ptr<PeakBuilder> peaks;
+
+    out.isTagFirst = isTagFirst;
+    if (hlsDir.empty())
+        out.file.open(mp3FileName.c_str(), std::ios_base::binary | std::ofstream::out);
+    else {
+        out.segments.reset(new HlsSegmenter(hlsDir, options.hlsSegmentSeconds)); // the folder is made with the first segment
+        out.segments->setTagFirst(isTagFirst);
+    }
 
-    auto         pcmBuffer        = vector<int16_t>(PCM_BUF_SIZE, 0); // vector fills itself at construction by default
-    auto         mp3Buffer        = vector<uint8_t>(MP3_BUF_SIZE, 0); // element's value, so make it explicit
-    auto         outMp3           = std::ofstream(outFileName.c_str(), std::ios_base::binary | std::ofstream::out);
-    int32_t      toWrite          = 0;
-    int32_t      samplesReadTotal = 0;
-    bool         isMoreSamples    = true;
-    size_t const toRead           = PCM_BUF_SIZE / (isMono ? 2u : 1u); // read half of the buffer size in MONO mode
+    if (options.seekIndexFrames > 0) {
+        out.index.reset(new SeekIndexBuilder(options.seekIndexFrames));
+        out.index->setTagFirst(isTagFirst);
+    }
 
-    do {
-        inPcm.read(reinterpret_cast<char*>(pcmBuffer.data()), static_cast<std::streamsize>(toRead));
+    if (options.peakSamples > 0)
+        peaks.reset(new PeakBuilder(source->sampleRate, source->channels, options.peakSamples, options.peakLevels));
 
-        auto const bytesRead = static_cast<int32_t>(inPcm.gcount());
-        assert(bytesRead != 0);
-        auto samplesRead = bytesRead / (pcmHeader.bitsPerSample / 8) / pcmHeader.numChannels;
+    for (auto const& mp3 : pieceMp3) {
+        writeMp3(out, mp3.data(), static_cast<int32_t>(mp3.size()), result, options);
+        samplesReadTotal = source->frames;
+    }
 
-        if (samplesReadTotal + samplesRead >= samplesDeclared) {
-            samplesRead = static_cast<int32_t>(samplesDeclared - samplesReadTotal);
-            isMoreSamples = false;
+    for (; samplesRead > 0; samplesRead = source->acquire(pcm, pcmBuffer.data(), maxFrames)) {
+        if (result.isDualMono && maxChannelDifference(pcm, samplesRead) > options.dualMonoThreshold) {
+            result.isDualMonoBroken = true;
+            break;
         }
 
         samplesReadTotal += samplesRead;
 
-        if (isMono) {
-            int16_t* emptyChannel = pcmBuffer.data() + pcmBuffer.size() / 2;
-            assert(std::all_of(emptyChannel, emptyChannel + pcmBuffer.size() / 2, [](auto b){ return b == 0; })); // is right channel empty?
-            toWrite = ::lame_encode_buffer(pLameGF, pcmBuffer.data(), emptyChannel, samplesRead, mp3Buffer.data(), MP3_BUF_SIZE);
+        if (peaks) // same pass as encoding, the chunk is still in cache
+            peaks->add(pcm, samplesRead);
+
+        if (options.isManifest)
+            result.pcmCrc = crc32c(result.pcmCrc, pcm, samplesRead * source->channels * sizeof(int16_t));
+
+        if (isSilentSoFar) {
+            if (maxAbsSample(pcm, samplesRead * source->channels) <= options.silenceThreshold)
+                continue;
+
+            if (samplesReadTotal > samplesRead) { // silence held back has to be encoded after all
+                result.isSilenceBroken = true;
+                break;
+            }
+
+            isSilentSoFar = false;
+        }
+
+        toWrite = encoder->encode(pcm, samplesRead, mp3Buffer.data(), MP3_BUF_SIZE);
+
+        if (toWrite < 0) {
+            dropFailedOutput(out, mp3FileName, inFileName);
+            return result;
         }
-        else
-            toWrite = ::lame_encode_buffer_interleaved(pLameGF, pcmBuffer.data(), samplesRead, mp3Buffer.data(), MP3_BUF_SIZE);
 
-        assert(toWrite >= 0);
-        outMp3.write(reinterpret_cast<char*>(mp3Buffer.data()), toWrite);
-    } while (!inPcm.eof() && isMoreSamples);
+        writeMp3(out, mp3Buffer.data(), toWrite, result, options);
+        addPoolProgress(static_cast<double>(samplesRead) / source->sampleRate); // for --adaptive
 
-    assert(samplesDeclared == samplesReadTotal);
-    toWrite = ::lame_encode_flush(pLameGF, mp3Buffer.data(), MP3_BUF_SIZE);
-    outMp3.write(reinterpret_cast<char*>(mp3Buffer.data()), toWrite);
-    outMp3.flush();
-    outMp3.close();
-    inPcm.close();
-    ::lame_close(pLameGF);
+        if (options.isFollow && samplesRead < maxFrames) // caught up with the recorder, listeners get what there is
+            out.file.flush();
+    }
+
+    if (result.isDualMonoBroken || result.isSilenceBroken)
+        return result;
+
+    result.isSilent = isSilentSoFar && samplesReadTotal > 0;
+
+    if (result.isSilent && options.silenceMode == SilenceMode::Skip) {
+        if (out.file.is_open()) {
+            out.file.close();
+            ::remove(mp3FileName.c_str());
+        }
+        result.audioSeconds = static_cast<double>(samplesReadTotal) / source->sampleRate;
+        return result;
+    }
+
+    auto const outRate    = encoder->outSampleRate();
+    auto const outSamples = samplesReadTotal * outRate / source->sampleRate; // the encoder may resample
+
+    if (!isSplit && (!result.isSilent || !writeSilence(out, outRate, isMono ? 1 : 2, outSamples, result, options))) {
+        std::fill(pcmBuffer.begin(), pcmBuffer.end(), 0);
+
+        for (int64_t left = result.isSilent ? samplesReadTotal : 0; left > 0; left -= maxFrames) { // held back silence, no frames for the rate
+            auto const samples = static_cast<int32_t>(std::min<int64_t>(left, maxFrames));
+            toWrite = encoder->encode(pcmBuffer.data(), samples, mp3Buffer.data(), MP3_BUF_SIZE);
+
+            if (toWrite < 0)
+                break;
+
+            writeMp3(out, mp3Buffer.data(), toWrite, result, options);
+        }
+
+        if (toWrite >= 0)
+            toWrite = encoder->flush(mp3Buffer.data(), MP3_BUF_SIZE);
+
+        if (toWrite < 0) {
+            dropFailedOutput(out, mp3FileName, inFileName);
+            return result;
+        }
+
+        writeMp3(out, mp3Buffer.data(), toWrite, result, options);
+    }
+
+    writeTag(out, *encoder, result, options);
+    out.file.close();
+
+    if (out.segments && !out.segments->finish()) {
+        ::pthread_mutex_lock(&consoleMtx);
+        cerr << "ERROR! Can't write HLS segments to " << hlsDir << endl;
+        ::pthread_mutex_unlock(&consoleMtx);
+    }
 
+    if (out.index && !out.index->write(mp3FileName.substr(0, mp3FileName.size() - 3) + "seek")) {
+        ::pthread_mutex_lock(&consoleMtx);
+        cerr << "ERROR! Can't write seek index for " << mp3FileName << endl;
+        ::pthread_mutex_unlock(&consoleMtx);
+    }
+
+    if (peaks) {
+        auto const peaksFileName = mp3FileName.substr(0, mp3FileName.size() - 3) + (options.isPeaksJson ? "peaks.json" : "peaks");
+        peaks->finish();
+
+        if (!(options.isPeaksJson ? peaks->writeJson(peaksFileName) : peaks->writeBinary(peaksFileName))) {
+            ::pthread_mutex_lock(&consoleMtx);
+            cerr << "ERROR! Can't write peaks file " << peaksFileName << endl;
+            ::pthread_mutex_unlock(&consoleMtx);
+        }
+    }
+
+    if (!isQuiet) {
+        ::pthread_mutex_lock(&consoleMtx);
+        cout << "Finished encoding file " << outFileName << endl;
+        ::pthread_mutex_unlock(&consoleMtx);
+    }
+
+    result.isEncoded     = true;
+    result.audioSeconds  = static_cast<double>(samplesReadTotal) / source->sampleRate;
+    result.outFileName   = outFileName;
+    result.inSampleRate  = source->sampleRate;
+    result.outSampleRate = outRate;
+    return result;
+}
+
+
+// pool job: 1 file - 1 job
+// sadly, lame doesn't support multithread encoding for a singlle file...
+static JobResult encodeFile(Job const& job, Options const& options)
+{
+    auto const inFileName = job.name.c_str();
+
+    // both checks need to start over if they fail, live streams can't
+    bool const isReopenable      = !isShmInput(inFileName);
+    bool       isDualMonoAllowed = options.dualMonoThreshold >= 0 && isReopenable;
+    bool       isSilenceAllowed  = options.silenceMode != SilenceMode::Off && isReopenable;
+
+    for (;;) {
+        auto const result = encodeFileWith(job, options, isDualMonoAllowed, isSilenceAllowed);
+
+        if (!result.isDualMonoBroken && !result.isSilenceBroken)
+            return result;
+
+        if (result.isDualMonoBroken && !isQuiet) {
+            ::pthread_mutex_lock(&consoleMtx);
+            cout << "Channels differ later on, encoding again as stereo: " << inFileName << endl;
+            ::pthread_mutex_unlock(&consoleMtx);
+        }
+
+        isDualMonoAllowed = isDualMonoAllowed && !result.isDualMonoBroken;
+        isSilenceAllowed  = isSilenceAllowed  && !result.isSilenceBroken; // sound after a silent intro
+    }
+}
+
+
+struct Batch
+{
+    vector<Job> const* jobs;
+    Options const*     options;
+    vector<JobResult>  results;
+};
+
+
+static void encodeJob(size_t jobIdx, void* ctx)
+{
+    auto& batch = *static_cast<Batch*>(ctx);
+    acquireHostToken();
+    batch.results[jobIdx] = encodeFile((*batch.jobs)[jobIdx], *batch.options);
+    releaseHostToken();
+}
+
+
+// name.<start>-<end>.mp3 for a part of name.wav, times in seconds
+static string makeRangeOutFileName(string const& inFileName, double start, double end)
+{
+    auto const format = [](double seconds) {
+        auto text = std::to_string(std::llround(seconds * 1000) / 1000.0); // ms are plenty for a name
+        text.erase(text.find_last_not_of('0') + 1);
+        if (text.back() == '.')
+            text.pop_back();
+        return text;
+    };
+
+    auto outFileName = changeExtention(inFileName);
+    outFileName.resize(outFileName.size() - 4);
+    return outFileName + "." + format(start) + "-" + (end > 0 ? format(end) : "end") + ".mp3";
+}
+
+
+// a job per clip of a bundle, name.e2mb is encoded into the folder name/ keeping
+// the relative paths the clips were packed with
+static void addClipJobs(string const& bundleName, size_t root, vector<Job>& jobs)
+{
+    string     error;
+    auto const bundle = openBundle(bundleName, error);
+
+    if (!bundle) {
+        cerr << "ERROR! " << error << ": " << bundleName << endl;
+        return;
+    }
+
+    auto const       outDir = bundleName.substr(0, bundleName.size() - 5);
+    std::set<string> dirs   = { outDir };
+
+    for (size_t clipIdx = 0; clipIdx < bundle->clips().size(); ++clipIdx) {
+        auto const& name = bundle->clips()[clipIdx].name;
+
+        if (name.empty() || name[0] == '/' || name.find("..") != string::npos || name.back() == '/') { // stays inside outDir
+            cerr << "ERROR! Bad clip name " << name << ": " << bundleName << endl;
+            continue;
+        }
+
+        for (auto slashPos = name.find('/'); slashPos != string::npos; slashPos = name.find('/', slashPos + 1))
+            dirs.insert(outDir + "/" + name.substr(0, slashPos));
+
+        Job job;
+        job.name    = bundleName;
+        job.cost    = bundle->clips()[clipIdx].bytes;
+        job.root    = root;
+        job.outName = changeExtention(outDir + "/" + name);
+        job.clip    = static_cast<int64_t>(clipIdx);
+        jobs.push_back(job);
+    }
+
+    for (auto const& dir : dirs) // parents sort before their children
+        makeDir(dir.c_str());
+}
+
+
+// expand all inputs into one queue, the most expensive jobs go first
+// so the tail of the run isn't left to a single long file
+vector<Job> collectJobs(Options const& options)
+{
+    const constexpr uint64_t MP3_COST      = 8;      // decoding + encoding a compressed byte vs a PCM byte
+    const constexpr uint64_t ZIP_COST      = 2;      // gzip and zstd get little out of PCM, plus the decoding
+    const constexpr double   RANGE_BYTES_S = 192000; // a part's cost, 48 kHz stereo, the header isn't read here
+
+    auto const&      inputs       = options.inputs;
+    auto const       outSuffix    = "." + std::to_string(options.bitrate > 0 ? options.bitrate : DEFAULT_BITRATE) + "k.mp3";
+    auto             inExtentions = extentions;
+    vector<Job>      jobs;
+    std::set<string> names; // same file may come from several inputs
+
+    if (options.isTranscode)
+        inExtentions.push_back("mp3");
+    inExtentions.push_back("e2mb");
+
+    for (size_t root = 0; root < inputs.size(); ++root) {
+        if (isShmInput(inputs[root])) { // live streams go first, their producers block on a full ring
+            Job job;
+            job.name = inputs[root];
+            job.cost = std::numeric_limits<uint64_t>::max();
+            job.root = root;
+            jobs.push_back(job);
+            continue;
+        }
+
+        if (std::find(options.rangeLists.begin(), options.rangeLists.end(), root) != options.rangeLists.end())
+            continue; // see below
+
+        for (auto const& file : expandInput(inputs[root], inExtentions)) {
+            if (isBundleName(file.name)) {
+                if (names.insert(file.name).second)
+                    addClipJobs(file.name, root, jobs);
+                continue;
+            }
+
+            bool const isMp3 = isMp3Name(file.name);
+
+            if (isMp3 && endsWith(file.name, outSuffix)) // result of an earlier transcoding
+                continue;
+
+            bool const isZip = stripCompressedExtention(file.name).size() != file.name.size();
+
+            if (!names.insert(file.name).second)
+                continue;
+
+            Job job;
+            job.name = file.name;
+            job.cost = file.size * (isMp3 ? MP3_COST : isZip ? ZIP_COST : 1);
+            job.root = root;
+            jobs.push_back(job);
+        }
+    }
+
+    std::set<string> outNames; // MP3s this run writes from WAVs aren't inputs
+    for (auto const& job : jobs)
+        if (!isMp3Name(job.name))
+            outNames.insert(changeExtention(job.name));
+
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&outNames](Job const& job) { return outNames.count(job.name) > 0; }),
+               jobs.end());
+
+    for (auto& job : jobs) { // clips too
+        job.start   = options.startSeconds;
+        job.end     = options.endSeconds;
+        job.encoder = options.encoder;
+    }
+
+    for (auto const& rangeJob : options.rangeJobs) { // parts of the same file are separate jobs
+        PathName   pathName;
+        auto const size = statPath(rangeJob.input.c_str(), pathName) ? pathName.size : 0;
+        auto const cost = rangeJob.end > 0 ? std::min<uint64_t>(size, static_cast<uint64_t>((rangeJob.end - rangeJob.start) * RANGE_BYTES_S)) : size;
+        auto const name = isShmInput(rangeJob.input) ? rangeJob.input : getCanonicalPath(rangeJob.input.c_str());
+        auto       out  = rangeJob.outName.empty() ? makeRangeOutFileName(name, rangeJob.start, rangeJob.end) : rangeJob.outName;
+        auto const slashPos = out.find_last_of("/\\");
+
+        if (!rangeJob.outName.empty()) // canonical folder, manifests are per folder
+            out = getCanonicalPath(slashPos == string::npos ? "." : out.substr(0, slashPos).c_str()) + "/" + out.substr(slashPos + 1);
+
+        Job job;
+        job.name    = name;
+        job.cost    = cost;
+        job.root    = rangeJob.root;
+        job.start   = rangeJob.start;
+        job.end     = rangeJob.end;
+        job.outName = out;
+        job.encoder = options.encoder;
+
+        if (!rangeJob.encoder.empty())
+            parseEncoder(rangeJob.encoder, job.encoder); // checked when the list was read
+
+        jobs.push_back(job);
+    }
+
+    std::stable_sort(jobs.begin(), jobs.end(), [](Job const& a, Job const& b) { return a.cost > b.cost; });
+    return jobs;
+}
+
+
+static void logTuning(size_t fromWorkers, size_t toWorkers, double rate, double ioWait, char const* reason)
+{
     ::pthread_mutex_lock(&consoleMtx);
-    cout << "Finished encoding file " << outFileName << endl;
+    cout << "Workers " << fromWorkers << " -> " << toWorkers << ": " << std::fixed << std::setprecision(1)
+         << rate << " audio-s/s, iowait " << std::llround(ioWait * 100) << "% (" << reason << ")" << endl;
     ::pthread_mutex_unlock(&consoleMtx);
-    return nullptr;
 }
 
 
-// run worker for each file in a list
-static void encodeAll2Mp3(PathNames const& files)
+// encode all jobs on workerNum pool threads, or start there and tune with --adaptive,
+// results are in jobs order
+static PoolStats encodeAll2Mp3(vector<Job> const& jobs, Options const& options, size_t workerNum, vector<JobResult>& results,
+                               bool isTuned = false)
 {
-    vector<Worker> workers(files.size());
+    Batch      batch = { &jobs, &options, vector<JobResult>(jobs.size()) };
+    PoolTuning tuning;
 
-    for (size_t idx = 0; idx < files.size(); ++idx) {
-        void* file = reinterpret_cast<void*>(const_cast<char*>(files[idx].name.c_str()));
+    tuning.minWorkers = options.minWorkers;
+    tuning.maxWorkers = isTuned ? options.maxWorkers : 0;
+    tuning.log        = &logTuning;
 
-        if (::pthread_create(&workers[idx].thread, nullptr, &encode2mp3Worker, file) != 0)
-            throw std::runtime_error("pthread_create() failed");
+    auto const stats = runPool(jobs.size(), workerNum, &encodeJob, &batch, options.isBackground, &tuning);
+    results = std::move(batch.results);
+
+    if (stats.isPriorityKept) // workers are done, the console is ours
+        cerr << "WARNING: can't lower worker priority" << endl;
+    return stats;
+}
+
+
+// JobResult as a worker process hands it back through shared memory,
+// outFileName follows from the job
+struct ProcessResult
+{
+    double   audioSeconds;
+    uint64_t mp3Bytes;
+    uint32_t pcmCrc;
+    uint32_t mp3Crc;
+    int32_t  inSampleRate;
+    int32_t  outSampleRate;
+    bool     isEncoded;
+    bool     isDualMono;
+    bool     isSilent;
+    bool     isSpeech;
+};
+
+
+static void encodeProcessJob(size_t jobIdx, void* out, void* ctx)
+{
+    encodeJob(jobIdx, ctx);
+
+    auto const&         result = static_cast<Batch*>(ctx)->results[jobIdx];
+    ProcessResult const shared = { result.audioSeconds, result.mp3Bytes, result.pcmCrc, result.mp3Crc, result.inSampleRate,
+                                   result.outSampleRate, result.isEncoded, result.isDualMono, result.isSilent, result.isSpeech };
+    ::memcpy(out, &shared, sizeof(shared));
+}
+
+
+// a worker died on the job: whatever it wrote of the MP3 (or HLS stream) and its
+// seek index and peaks is cut short, none of it stays
+static void dropCrashedOutput(size_t jobIdx, void* ctx)
+{
+    auto const& batch       = *static_cast<Batch*>(ctx);
+    auto const& job         = (*batch.jobs)[jobIdx];
+    auto const& options     = *batch.options;
+    auto const  mp3FileName = job.outName.empty() ? makeOutFileName(job.name, options) : job.outName;
+    auto const  baseName    = mp3FileName.substr(0, mp3FileName.size() - 3);
+
+    if (options.hlsSegmentSeconds > 0)
+        HlsSegmenter::remove(mp3FileName.substr(0, mp3FileName.size() - 4) + ".hls");
+    else
+        ::remove(mp3FileName.c_str());
+
+    if (options.seekIndexFrames > 0)
+        ::remove((baseName + "seek").c_str());
+    if (options.peakSamples > 0)
+        ::remove((baseName + (options.isPeaksJson ? "peaks.json" : "peaks")).c_str());
+}
+
+
+// --processes: all jobs on forked worker processes, results in jobs order;
+// files a worker died on are reported, count as not encoded and leave no output
+static void encodeAllInProcesses(vector<Job> const& jobs, Options const& options, vector<JobResult>& results)
+{
+    Batch           batch = { &jobs, &options, vector<JobResult>(jobs.size()) };
+    vector<uint8_t> shared;
+    vector<uint8_t> isDone;
+    ProcessStats    stats;
+    string          error;
+
+    results.assign(jobs.size(), JobResult());
+
+    if (!runProcessPool(jobs.size(), options.processNum, sizeof(ProcessResult), &encodeProcessJob, &dropCrashedOutput, &batch,
+                        options.isBackground, shared, isDone, stats, error)) {
+        cerr << "ERROR! " << error << endl;
+        return;
+    }
+
+    for (size_t jobIdx = 0; jobIdx < jobs.size(); ++jobIdx) {
+        ProcessResult processResult;
+        auto&         result = results[jobIdx];
+
+        if (!isDone[jobIdx])
+            continue;
+
+        ::memcpy(&processResult, shared.data() + jobIdx * sizeof(ProcessResult), sizeof(ProcessResult));
+        result.isEncoded     = processResult.isEncoded;
+        result.audioSeconds  = processResult.audioSeconds;
+        result.mp3Bytes      = processResult.mp3Bytes;
+        result.pcmCrc        = processResult.pcmCrc;
+        result.mp3Crc        = processResult.mp3Crc;
+        result.isDualMono    = processResult.isDualMono;
+        result.isSilent      = processResult.isSilent;
+        result.isSpeech      = processResult.isSpeech;
+        result.inSampleRate  = processResult.inSampleRate;
+        result.outSampleRate = processResult.outSampleRate;
+        result.outFileName   = result.isEncoded ? makeJobOutFileName(jobs[jobIdx], options) : string();
+    }
+
+    for (auto const jobIdx : stats.crashedJobs)
+        cerr << "ERROR! Worker process died encoding " << jobs[jobIdx].name << endl;
+    if (stats.isPriorityKept)
+        cerr << "WARNING: can't lower worker priority" << endl;
+
+    double busySeconds = 0;
+    for (auto const seconds : stats.busySeconds)
+        busySeconds += seconds;
+
+    cout << "Worker processes: " << options.processNum << ", " << stats.respawns << " restarted, busy "
+         << std::llround(stats.wallSeconds > 0 ? busySeconds * 100 / (stats.wallSeconds * options.processNum) : 0) << "% of "
+         << std::fixed << std::setprecision(1) << stats.wallSeconds << " s\n";
+}
+
+
+// on worker processes with --processes, else on the pool, tuned with --adaptive;
+// the bundles of the jobs stay mapped for the batch, not longer
+vector<JobResult> encodeJobs(vector<Job> const& jobs, Options const& options)
+{
+    vector<JobResult>                               results;
+    std::map<string, std::shared_ptr<Bundle const>> bundles;
+
+    for (auto const& job : jobs) {
+        string error; // reported by the job
+        if (job.clip >= 0 && bundles.count(job.name) == 0)
+            bundles[job.name] = openBundle(job.name, error);
     }
 
-    for (auto& worker : workers)
-        ::pthread_join(worker.thread, &worker.pStatus);
+    if (options.processNum > 0)
+        encodeAllInProcesses(jobs, options, results);
+    else
+        encodeAll2Mp3(jobs, options, options.workerNum > 0 ? options.workerNum : defaultWorkerNum(), results, true);
+    return results;
 }
 
 
-static void printExtentionsMsg()
+vector<string> const& inputExtentions()
 {
-    cout << "Supported file extentions: ";
-    for (auto const& ext : extentions)
-        cout << '.' << ext << " ";
-    cout << "\n";
+    return extentions;
 }
 
 
-int main(int argNum, char** args)
+static double sumAudioSeconds(vector<JobResult> const& results)
 {
-    printExtentionsMsg();
+    double audioSeconds = 0;
+    for (auto const& result : results)
+        audioSeconds += result.audioSeconds;
+    return audioSeconds;
+}
 
-    if (argNum != 2) {
-        cerr << "Error: folder not specified!\n"
-                "Usage: encode2mp3 folder_name\n";
 
-        return -1;
+// encode the same set of files with 1, 2, 4 ... maxWorkers workers and report
+// how well the pool scales; stops as soon as adding workers stops paying off
+void runScalingBench(vector<Job> const& jobs, Options const& options, size_t maxWorkers)
+{
+    const constexpr double MIN_GAIN = 1.05; // next step must be at least 5% faster
+
+    cout << "Scaling benchmark: " << jobs.size() << " files, up to " << maxWorkers << " workers\n"
+         << "workers   wall,s  audio-s/s  speedup  efficiency  idle avg,s  idle max,s\n";
+
+    isQuiet = true;
+    double baseWall    = 0;
+    double prevSpeedup = 0;
+    size_t prevWorkers = 0;
+
+    for (size_t workerNum = 1; ; ) {
+        vector<JobResult> results;
+        auto const stats        = encodeAll2Mp3(jobs, options, workerNum, results);
+        auto const audioSeconds = sumAudioSeconds(results);
+        auto const usedWorkers  = stats.busySeconds.size();
+        double     idleSum      = 0;
+        double     idleMax      = 0;
+
+        for (auto const busy : stats.busySeconds) {
+            idleSum += stats.wallSeconds - busy;
+            idleMax  = std::max(idleMax, stats.wallSeconds - busy);
+        }
+
+        if (baseWall == 0)
+            baseWall = stats.wallSeconds;
+
+        auto const speedup = stats.wallSeconds > 0 ? baseWall / stats.wallSeconds : 0.0;
+
+        cout << std::fixed << std::setprecision(3)
+             << std::setw(7)  << usedWorkers
+             << std::setw(9)  << stats.wallSeconds
+             << std::setw(11) << (stats.wallSeconds > 0 ? audioSeconds / stats.wallSeconds : 0.0)
+             << std::setw(9)  << speedup
+             << std::setw(12) << speedup / usedWorkers
+             << std::setw(12) << idleSum / usedWorkers
+             << std::setw(12) << idleMax << endl;
+
+        if (workerNum >= std::min(maxWorkers, jobs.size())) // no more workers to add or no files for them
+            break;
+
+        if (usedWorkers > 1 && speedup < prevSpeedup * MIN_GAIN) {
+            cout << "Stopped: " << usedWorkers << " workers are not faster than " << prevWorkers << endl;
+            break;
+        }
+
+        prevSpeedup = speedup;
+        prevWorkers = usedWorkers;
+        workerNum   = std::min(workerNum * 2, maxWorkers);
     }
-    
-    if (!checkPath(args[1])) {
-        cerr << "ERROR! UNIX console detected! Please, use '/' or '\\\\' path separators instead of '\\'\n";
+
+    isQuiet = false;
+}
+
+
+// encode all jobs from memory on this thread with every built in encoder,
+// nothing is written, so only the encoders are measured
+void runEncoderBench(vector<Job> const& jobs, Options const& options)
+{
+    struct Input
+    {
+        int32_t         sampleRate;
+        int32_t         channels;
+        vector<int16_t> pcm;
+    };
+
+    vector<Input> inputs;
+    double        audioSeconds = 0;
+
+    for (auto const& job : jobs) {
+        string error;
+        auto   source = openJobSource(job, options, error);
+
+        if (!source) {
+            cerr << "ERROR! " << error << ": " << job.name << endl;
+            continue;
+        }
+
+        Input input = { source->sampleRate, source->channels, {} };
+        auto  chunk = vector<int16_t>(PCM_BUF_SIZE);
+
+        for (int32_t framesRead; (framesRead = source->read(chunk.data(), static_cast<int32_t>(PCM_BUF_SIZE) / input.channels)) > 0;)
+            input.pcm.insert(input.pcm.end(), chunk.begin(), chunk.begin() + framesRead * input.channels);
+
+        audioSeconds += static_cast<double>(input.pcm.size()) / input.channels / input.sampleRate;
+        inputs.push_back(std::move(input));
+    }
+
+    cout << "Encoder benchmark: " << inputs.size() << " files, " << std::fixed << std::setprecision(1) << audioSeconds << " s of audio\n"
+         << "encoder   wall,s  audio-s/s   MB/s out\n";
+
+    for (auto const kind : { EncoderKind::Lame, EncoderKind::Fast }) {
+        if (!isEncoderAvailable(kind)) {
+            cout << std::setw(7) << encoderName(kind) << "  not built in" << endl;
+            continue;
+        }
+
+        auto const start    = std::chrono::steady_clock::now();
+        auto       mp3      = vector<uint8_t>(MP3_BUF_SIZE);
+        uint64_t   mp3Bytes = 0;
+        string     error;
+
+        for (auto const& input : inputs) {
+            bool const isMono    = input.channels == 1 || options.musicPreset.isMono;
+            auto const settings  = makeSettings(input.channels, input.sampleRate, options.musicPreset, options, isMono, false);
+            auto const encoder   = makeEncoder(kind, settings, error);
+            auto const maxFrames = static_cast<int32_t>(PCM_BUF_SIZE) / input.channels;
+            auto const frames    = static_cast<int64_t>(input.pcm.size()) / input.channels;
+
+            if (!encoder)
+                break;
+
+            for (int64_t first = 0; first < frames; first += maxFrames) {
+                auto const toEncode = static_cast<int32_t>(std::min<int64_t>(maxFrames, frames - first));
+                mp3Bytes += static_cast<uint64_t>(std::max(0, encoder->encode(input.pcm.data() + first * input.channels, toEncode, mp3.data(), MP3_BUF_SIZE)));
+            }
+
+            mp3Bytes += static_cast<uint64_t>(std::max(0, encoder->flush(mp3.data(), MP3_BUF_SIZE)));
+        }
+
+        auto const wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (!error.empty()) {
+            cout << std::setw(7) << encoderName(kind) << "  " << error << endl;
+            continue;
+        }
+
+        cout << std::fixed << std::setprecision(3)
+             << std::setw(7)  << encoderName(kind)
+             << std::setw(9)  << wall
+             << std::setw(11) << (wall > 0 ? audioSeconds / wall : 0.0)
+             << std::setw(11) << (wall > 0 ? mp3Bytes / 1e6 / wall : 0.0) << endl;
+    }
+}
+
+
+// --pack: PCM of every job into one bundle, clips named by their path relative to
+// the input folder they were found in (file name for other inputs), in name order
+int packJobs(vector<Job> jobs, Options const& options)
+{
+    BundleWriter writer;
+    string       error;
+    auto const   packName  = getCanonicalPath(options.packFile.c_str()); // realpath if there is one from before
+    auto         pcmBuffer = vector<int16_t>(PCM_BUF_SIZE);
+    size_t       packed    = 0;
+
+    std::stable_sort(jobs.begin(), jobs.end(), [](Job const& a, Job const& b) { return a.name < b.name || (a.name == b.name && a.clip < b.clip); });
+
+    if (!writer.open(options.packFile, error)) {
+        cerr << "ERROR! " << error << ": " << options.packFile << endl;
         return -1;
     }
 
-    auto const& files = filterFiles(getCanonicalDirContents(args[1]), extentions);
+    for (auto const& job : jobs) {
+        if (job.name == packName) // the bundle being written, mapped from before
+            continue;
+
+        auto source = openJobSource(job, options, error);
+
+        if (!source) {
+            cerr << "ERROR! " << error << ": " << job.name << endl;
+            continue;
+        }
+
+        PathName   root;
+        auto const rootDir = getCanonicalPath(options.inputs[job.root].c_str()) + "/";
+        auto const isInDir = statPath(options.inputs[job.root].c_str(), root) && root.type == PathType::Dir
+                          && job.name.compare(0, rootDir.size(), rootDir) == 0;
+        auto       name    = isInDir ? job.name.substr(rootDir.size()) : job.name.substr(job.name.find_last_of("/\\") + 1);
+
+        if (job.clip >= 0)
+            name = openBundle(job.name, error)->clips()[static_cast<size_t>(job.clip)].name;
+
+        writer.addClip(name, source->sampleRate, source->channels);
+
+        int32_t const maxFrames = static_cast<int32_t>(PCM_BUF_SIZE) / source->channels;
+        int16_t const* pcm      = nullptr;
+
+        for (int32_t framesRead; (framesRead = source->acquire(pcm, pcmBuffer.data(), maxFrames)) > 0;)
+            writer.write(pcm, framesRead);
+
+        ++packed;
+    }
 
-    if (files.empty()) {
-        cerr << "An error happened or the directory doesn't exist or has no supported files!\n";
+    if (!writer.close(error)) {
+        cerr << "ERROR! " << error << ": " << options.packFile << endl;
         return -1;
     }
 
-    cout << "Found " << files.size() << " files to encode\n";
-    encodeAll2Mp3(files);
+    cout << "Packed " << packed << " of " << jobs.size() << " files into " << options.packFile << "\n";
     return 0;
 }
@@ -6,19 +6,54 @@
 #include <vector>
 #include <pthread.h>
 
+#include "options.hpp"
+
 enum class PathType : uint8_t { File, Dir };
 
 struct Worker
 {
     int32_t   status;
-    void*     pStatus = &status;
+    void*     pStatus        = &status;
     pthread_t thread;
+    void*     pool           = nullptr;
+    double    busySeconds    = 0;
+    bool      isPriorityKept = false; // background asked for and not granted
+};
+
+struct JobResult
+{
+    bool        isEncoded        = false;
+    double      audioSeconds     = 0;
+    std::string outFileName;
+    uint64_t    mp3Bytes         = 0;
+    uint32_t    pcmCrc           = 0;     // CRC32C of PCM data as fed to the encoder
+    uint32_t    mp3Crc           = 0;     // CRC32C of the written MP3 file
+    bool        isDualMono       = false; // stereo input encoded as mono
+    bool        isDualMonoBroken = false; // channels split after the start, needs stereo
+    bool        isSilent         = false; // nothing above the silence threshold
+    bool        isSilenceBroken  = false; // sound after a held back silent intro, needs encoding
+    bool        isSpeech         = false; // classified as speech, encoded with the speech preset
+    int32_t     inSampleRate     = 0;
+    int32_t     outSampleRate    = 0;     // lower than inSampleRate when the bandwidth allowed
 };
 
 struct PathName
 {
     PathType    type;
     std::string name;
+    uint64_t    size = 0; // bytes, files only
+};
+
+struct Job
+{
+    std::string name;
+    uint64_t    cost  = 0; // used to order the queue, bigger goes first
+    size_t      root  = 0; // index of the command line input the file came from
+    double      start = 0; // part of the file to encode in seconds, end 0 - up to the end
+    double      end   = 0;
+    std::string outName;   // empty - derived from name
+    EncoderKind encoder = EncoderKind::Lame;
+    int64_t     clip    = -1; // index of a clip in the bundle name, -1 - name is the input itself
 };
 
 //canonical format
@@ -41,4 +76,17 @@ struct PcmHeader
 };
 #pragma pack (pop)
 
+// the encoder without its command line, in the engine library: an application
+// embedding it collects the jobs of its options, may set an Executor (pool.hpp)
+// for them to run on and encodes them; progress goes to the console as with the
+// command line
+std::vector<std::string> const& inputExtentions(); // lower case, without the dot
+std::vector<Job>       collectJobs(Options const& options); // empty if the inputs have no supported files
+std::vector<JobResult> encodeJobs(std::vector<Job> const& jobs, Options const& options); // in jobs order
+
+// --scaling-bench, --encoder-bench and --pack of the command line
+void runScalingBench(std::vector<Job> const& jobs, Options const& options, size_t maxWorkers);
+void runEncoderBench(std::vector<Job> const& jobs, Options const& options);
+int  packJobs(std::vector<Job> jobs, Options const& options);
+
 #endif // ENCODE2MP3_H
@@ -0,0 +1,111 @@
+#include <stdexcept>
+
+#include <lame/lame.h>
+
+#include "encoder.hpp"
+#include "fastencoder.hpp"
+
+using std::string;
+
+namespace
+{
+// test lame functions for success or throw with details
+void okOrThrow(int32_t status, int line)
+{
+    if (status != lame_errorcodes_t::LAME_OKAY)
+        throw std::runtime_error("lame failed with code " + std::to_string(status) + " at line " + std::to_string(line));
+}
+
+
+class LameEncoder : public Mp3Encoder
+{
+public:
+    explicit LameEncoder(int32_t channels)
+        : pLameGF(::lame_init())
+        , channels(channels)
+    {}
+
+    ~LameEncoder() override
+    {
+        if (pLameGF)
+            ::lame_close(pLameGF);
+    }
+
+    // false with error set on lame errors
+    bool init(EncoderSettings const& settings, string& error)
+    {
+        if (!pLameGF) {
+            error = "lame_init failed";
+            return false;
+        }
+
+        try {
+            okOrThrow(::lame_set_num_channels (pLameGF, settings.channels),               __LINE__);
+            okOrThrow(::lame_set_mode         (pLameGF, settings.isMono ? MONO : STEREO), __LINE__);
+            okOrThrow(::lame_set_in_samplerate(pLameGF, settings.inSampleRate),           __LINE__);
+            if (settings.outSampleRate > 0)
+                okOrThrow(::lame_set_out_samplerate(pLameGF, settings.outSampleRate),     __LINE__);
+            okOrThrow(::lame_set_VBR          (pLameGF, vbr_off),                         __LINE__); // keep it off, affects resulting mp3 length somehow
+            okOrThrow(::lame_set_quality      (pLameGF, settings.quality),                __LINE__);
+            if (settings.bitrate > 0)
+                okOrThrow(::lame_set_brate    (pLameGF, settings.bitrate),                __LINE__);
+            if (settings.isPiece) {
+                okOrThrow(::lame_set_disable_reservoir(pLameGF, 1),                       __LINE__);
+                okOrThrow(::lame_set_bWriteVbrTag     (pLameGF, 0),                       __LINE__);
+            }
+            okOrThrow(::lame_init_params      (pLameGF),                                  __LINE__);
+        }
+        catch (std::runtime_error const& e) {
+            error = e.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    int32_t encode(int16_t const* pcm, int32_t frames, uint8_t* mp3, int32_t size) override
+    {
+        auto const pcmIn = const_cast<int16_t*>(pcm); // lame doesn't write to input, just isn't const correct
+
+        if (channels == 1) // lame mixes interleaved stereo down itself in MONO mode
+            return ::lame_encode_buffer(pLameGF, pcmIn, pcmIn, frames, mp3, size);
+        return ::lame_encode_buffer_interleaved(pLameGF, pcmIn, frames, mp3, size);
+    }
+
+    int32_t flush(uint8_t* mp3, int32_t size) override { return ::lame_encode_flush(pLameGF, mp3, size); }
+    size_t  tag(uint8_t* frame, size_t size) override  { return ::lame_get_lametag_frame(pLameGF, frame, size); }
+
+    int32_t outSampleRate() const override { return ::lame_get_out_samplerate(pLameGF); }
+    int32_t frameSamples() const override  { return ::lame_get_framesize(pLameGF); }
+
+private:
+    lame_t  pLameGF;
+    int32_t channels;
+};
+} // namespace
+
+
+char const* encoderName(EncoderKind kind)
+{
+    return kind == EncoderKind::Fast ? "fast" : "lame";
+}
+
+
+bool isEncoderAvailable(EncoderKind kind)
+{
+    return kind == EncoderKind::Lame || isFastEncoderAvailable();
+}
+
+
+std::unique_ptr<Mp3Encoder> makeEncoder(EncoderKind kind, EncoderSettings const& settings, string& error)
+{
+    if (kind == EncoderKind::Fast)
+        return makeFastEncoder(settings, error);
+
+    std::unique_ptr<LameEncoder> encoder(new LameEncoder(settings.channels));
+
+    if (!encoder->init(settings, error))
+        return nullptr;
+
+    return encoder;
+}
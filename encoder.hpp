@@ -0,0 +1,48 @@
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+#include "options.hpp"
+
+struct EncoderSettings
+{
+    int32_t channels      = 2;     // of the PCM fed to encode()
+    int32_t inSampleRate  = 44100;
+    int32_t outSampleRate = 0;     // 0 - the encoder's choice
+    int32_t bitrate       = 0;     // CBR kbps, 0 - the encoder's default
+    int32_t quality       = 5;     // lame's 0 (best) .. 9 (fastest)
+    bool    isMono        = false; // mix stereo down to a mono MP3
+    bool    isPiece       = false; // frames must not depend on earlier ones, no Info tag (see --split)
+};
+
+// MP3 encoder backend, fed interleaved 16 bit PCM of any block size
+class Mp3Encoder
+{
+public:
+    virtual ~Mp3Encoder() = default;
+
+    // MP3 bytes written to mp3 (room for size bytes) for frames more PCM frames, < 0 on errors
+    virtual int32_t encode(int16_t const* pcm, int32_t frames, uint8_t* mp3, int32_t size) = 0;
+
+    // the rest of the stream
+    virtual int32_t flush(uint8_t* mp3, int32_t size) = 0;
+
+    // final Xing/Info tag frame to put over the first frame of the stream
+    // once it is flushed, 0 - the encoder writes none
+    virtual size_t tag(uint8_t* frame, size_t size) { (void)frame; (void)size; return 0; }
+
+    virtual int32_t outSampleRate() const = 0;
+    virtual int32_t frameSamples() const = 0; // per channel
+};
+
+char const* encoderName(EncoderKind kind);
+bool        isEncoderAvailable(EncoderKind kind); // built in, the fast one needs libshine
+
+// null with error set if the backend can't encode with these settings
+std::unique_ptr<Mp3Encoder> makeEncoder(EncoderKind kind, EncoderSettings const& settings, std::string& error);
+
+#endif // ENCODER_H
@@ -0,0 +1,164 @@
+#include <string.h>
+#include <vector>
+
+#include "fastencoder.hpp"
+
+#ifdef HAVE_SHINE
+extern "C" {
+#include <shine/layer3.h>
+}
+
+using std::string;
+
+namespace
+{
+// shine takes whole passes of samples only, blocks of other sizes are gathered here
+class FastEncoder : public Mp3Encoder
+{
+public:
+    ~FastEncoder() override
+    {
+        if (shine)
+            ::shine_close(shine);
+    }
+
+    bool init(EncoderSettings const& settings, string& error)
+    {
+        auto const bitrate = settings.bitrate > 0 ? settings.bitrate : 128;
+
+        if (settings.isPiece) { // shine always uses its bit reservoir
+            error = "the fast encoder can't encode independent pieces";
+            return false;
+        }
+
+        if (settings.outSampleRate > 0 && settings.outSampleRate != settings.inSampleRate) {
+            error = "the fast encoder doesn't resample";
+            return false;
+        }
+
+        if (::shine_check_config(settings.inSampleRate, bitrate) < 0) {
+            error = "the fast encoder has no " + std::to_string(settings.inSampleRate) + " Hz at " + std::to_string(bitrate) + " kbps";
+            return false;
+        }
+
+        inChannels  = settings.channels;
+        outChannels = settings.isMono ? 1 : settings.channels;
+        sampleRate  = settings.inSampleRate;
+
+        shine_config_t config;
+        ::shine_set_config_mpeg_defaults(&config.mpeg);
+        config.wave.channels   = outChannels == 1 ? PCM_MONO : PCM_STEREO;
+        config.wave.samplerate = sampleRate;
+        config.mpeg.mode       = outChannels == 1 ? MONO : STEREO;
+        config.mpeg.bitr       = bitrate;
+
+        shine = ::shine_initialisation(&config);
+        if (!shine) {
+            error = "shine_initialisation failed";
+            return false;
+        }
+
+        passSamples = ::shine_samples_per_pass(shine);
+        passLength  = static_cast<size_t>(passSamples) * outChannels;
+        pending.reserve(passLength);
+        return true;
+    }
+
+    int32_t encode(int16_t const* pcm, int32_t frames, uint8_t* mp3, int32_t size) override
+    {
+        int32_t written = 0;
+
+        for (int32_t frame = 0; frame < frames; ++frame) {
+            auto const in = pcm + frame * inChannels;
+
+            if (inChannels == outChannels)
+                pending.insert(pending.end(), in, in + inChannels);
+            else
+                pending.push_back(static_cast<int16_t>((in[0] + in[1]) / 2));
+
+            if (pending.size() == passLength && !encodePass(mp3, size, written))
+                return -1;
+        }
+
+        return written;
+    }
+
+    int32_t flush(uint8_t* mp3, int32_t size) override
+    {
+        int32_t written = 0;
+
+        if (!pending.empty()) {
+            pending.resize(passLength, 0);
+            if (!encodePass(mp3, size, written))
+                return -1;
+        }
+
+        int  toCopy = 0;
+        auto data   = ::shine_flush(shine, &toCopy);
+        return append(data, toCopy, mp3, size, written) ? written : -1;
+    }
+
+    int32_t outSampleRate() const override { return sampleRate; }
+    int32_t frameSamples() const override  { return passSamples; }
+
+private:
+    bool encodePass(uint8_t* mp3, int32_t size, int32_t& written)
+    {
+        int  toCopy = 0;
+        auto data   = ::shine_encode_buffer_interleaved(shine, pending.data(), &toCopy);
+        pending.clear();
+        return append(data, toCopy, mp3, size, written);
+    }
+
+    static bool append(uint8_t const* data, int toCopy, uint8_t* mp3, int32_t size, int32_t& written)
+    {
+        if (toCopy > size - written)
+            return false;
+
+        ::memcpy(mp3 + written, data, static_cast<size_t>(toCopy));
+        written += toCopy;
+        return true;
+    }
+
+    shine_t              shine       = nullptr;
+    int32_t              inChannels  = 0;
+    int32_t              outChannels = 0;
+    int32_t              sampleRate  = 0;
+    int32_t              passSamples = 0; // per channel
+    size_t               passLength  = 0; // samples of all channels
+    std::vector<int16_t> pending;         // interleaved, up to one pass
+};
+} // namespace
+
+
+bool isFastEncoderAvailable()
+{
+    return true;
+}
+
+
+std::unique_ptr<Mp3Encoder> makeFastEncoder(EncoderSettings const& settings, string& error)
+{
+    std::unique_ptr<FastEncoder> encoder(new FastEncoder());
+
+    if (!encoder->init(settings, error))
+        return nullptr;
+
+    return encoder;
+}
+
+#else // HAVE_SHINE
+
+bool isFastEncoderAvailable()
+{
+    return false;
+}
+
+
+std::unique_ptr<Mp3Encoder> makeFastEncoder(EncoderSettings const&, std::string& error)
+{
+    error = "the fast encoder needs a build with libshine";
+    return nullptr;
+}
+
+#endif // HAVE_SHINE
@@ -0,0 +1,12 @@
+#ifndef FASTENCODER_H
+#define FASTENCODER_H
+
+#include "encoder.hpp"
+
+// fixed-point backend on libshine: several times faster than lame and
+// well below it in quality, no resampling, no psychoacoustic model,
+// bitrate and mode are all there is to set; meant for previews
+bool                        isFastEncoderAvailable();
+std::unique_ptr<Mp3Encoder> makeFastEncoder(EncoderSettings const& settings, std::string& error);
+
+#endif // FASTENCODER_H
@@ -1,13 +1,16 @@
 #include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <errno.h>
 #include <string.h>
 #include <string>
 #include <vector>
 
+#include <sys/stat.h>
+
 #if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
 #include <dirent.h>
-#include <sys/stat.h>
 #else
 #include <windows.h>
 #include <tchar.h>
@@ -32,19 +35,15 @@ static void printErrorAndAbort(char const* msg)
 
 #if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
 // DIR or FILE or DIE!
-static PathType getPathType(char const* path)
+static PathName getPathName(char const* path)
 {
     if (!path)
         printErrorAndAbort("ERROR: path is NULL!");
 
-    struct stat s;
+    PathName pathName;
 
-    if (::stat(path, &s) == 0) {
-        if (s.st_mode & S_IFDIR)
-            return PathType::Dir;
-        if (s.st_mode & S_IFREG)
-            return PathType::File;
-    }
+    if (statPath(path, pathName))
+        return pathName;
 
     printErrorAndAbort("ERROR: giver dir has is neither a file nor a dir object!");
 }
@@ -71,7 +70,7 @@ PathNames getCanonicalDirContents(char const* dir)
             ::strcpy(filePath + dirLen + separatorLen, entry->d_name);
 
             if (char const* pth = ::realpath(filePath, realPath)) {
-                pathNames.push_back({ getPathType(pth), pth }); // emplace doesn't work
+                pathNames.push_back(getPathName(pth)); // emplace doesn't work
                 continue;
             }
 
@@ -124,7 +123,8 @@ PathNames getCanonicalDirContents(char const* dir)
         bool const isDir = (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
         auto path = std::string(buffer).append(separator).append(ffd.cFileName);
         auto type = isDir ? PathType::Dir : PathType::File;
-        pathNames.push_back({ type, std::move(path) });
+        auto size = (static_cast<uint64_t>(ffd.nFileSizeHigh) << 32) | ffd.nFileSizeLow;
+        pathNames.push_back({ type, std::move(path), size });
     } while (::FindNextFile(hFind, &ffd) != 0);
 
     if (::GetLastError() != ERROR_NO_MORE_FILES) {
@@ -138,6 +138,43 @@ PathNames getCanonicalDirContents(char const* dir)
 #endif
 
 
+// absolute path without "." and ".." parts, the path itself if it fails
+string getCanonicalPath(char const* path)
+{
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+    char realPath[PATH_MAX] = { 0, };
+    if (::realpath(path, realPath))
+        return realPath;
+#else
+    TCHAR buffer[MAX_PATH] = TEXT("");
+    if (::GetFullPathName(path, MAX_PATH, buffer, nullptr) != 0)
+        return buffer;
+#endif
+    return path;
+}
+
+
+// fill type and size of a file or a directory, false if path is neither
+bool statPath(char const* path, PathName& pathName)
+{
+    struct stat s;
+
+    if (!path || ::stat(path, &s) != 0)
+        return false;
+
+    if (s.st_mode & S_IFDIR)
+        pathName.type = PathType::Dir;
+    else if (s.st_mode & S_IFREG)
+        pathName.type = PathType::File;
+    else
+        return false;
+
+    pathName.name = path;
+    pathName.size = static_cast<uint64_t>(s.st_size);
+    return true;
+}
+
+
 // filter set of files by their extentions
 PathNames filterFiles(PathNames const& pathNames, vector<string> const& extentions)
 {
@@ -200,3 +237,61 @@ bool checkPath(const char* rawPath)
 
     return false;
 }
+
+
+// turn one command line input into the list of supported files:
+// a directory gives its own files, a file gives itself and "@list"
+// gives every file or directory named in the list file, one per line,
+// relative names are relative to the list file location
+PathNames expandInput(string const& input, vector<string> const& extentions)
+{
+    if (input.size() > 1 && input[0] == '@') {
+        auto const listName = input.substr(1);
+        auto const slashPos = listName.find_last_of("/\\");
+        auto const listDir  = slashPos == string::npos ? string() : listName.substr(0, slashPos + 1);
+        std::ifstream list(listName);
+        PathNames out;
+        string line;
+
+        if (!list)
+            cerr << "ERROR: can't open file list " << listName << "\n";
+
+        while (std::getline(list, line)) {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            if (line.empty() || line[0] == '#' || line[0] == '@') // no nested lists
+                continue;
+
+            bool const isAbsolute = line[0] == '/' || line[0] == '\\' || (line.size() > 1 && line[1] == ':');
+            auto const expanded   = expandInput(isAbsolute ? line : listDir + line, extentions);
+            out.insert(out.end(), expanded.begin(), expanded.end());
+        }
+
+        return out;
+    }
+
+    PathName pathName;
+
+    if (!statPath(input.c_str(), pathName)) {
+        cerr << "ERROR: " << input << " is neither a file nor a directory\n";
+        return {};
+    }
+
+    if (pathName.type == PathType::Dir)
+        return filterFiles(getCanonicalDirContents(input.c_str()), extentions);
+
+    pathName.name = getCanonicalPath(input.c_str());
+    return filterFiles({ pathName }, extentions);
+}
+
+
+// create a directory, true if it exists already
+bool makeDir(char const* path)
+{
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+    return ::mkdir(path, 0755) == 0 || errno == EEXIST;
+#else
+    return ::CreateDirectory(path, nullptr) || ::GetLastError() == ERROR_ALREADY_EXISTS;
+#endif
+}
@@ -7,6 +7,10 @@ using PathNames = std::vector<PathName>;
 
 PathNames filterFiles(PathNames const& pathNames, std::vector<std::string> const& extentions);
 PathNames getCanonicalDirContents(char const* dir);
+PathNames expandInput(std::string const& input, std::vector<std::string> const& extentions);
+std::string getCanonicalPath(char const* path);
+bool statPath(char const* path, PathName& pathName);
 bool checkPath(const char* rawPath);
+bool makeDir(char const* path);
 
 #endif // FILESYSTEM_H
@@ -0,0 +1,119 @@
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+#include "filesystem.hpp"
+#include "hls.hpp"
+
+using std::string;
+
+
+HlsSegmenter::HlsSegmenter(string const& dir, double segmentSeconds)
+    : dir(dir)
+    , segmentSeconds(segmentSeconds)
+{
+}
+
+
+string HlsSegmenter::segmentName(size_t idx)
+{
+    std::ostringstream name;
+    name << std::setw(5) << std::setfill('0') << idx << ".mp3";
+    return name.str();
+}
+
+
+bool HlsSegmenter::write(uint8_t const* data, size_t size)
+{
+    uint8_t const* frame = nullptr;
+    Mp3FrameInfo   info;
+
+    splitter.add(data, size);
+
+    while (isOk && splitter.next(frame, info)) {
+        auto const frameSeconds = static_cast<double>(info.samples) / info.sampleRate;
+        bool const isFirst      = !isStarted;
+        isStarted = true;
+
+        if (isFirst && isTagFirst && isTagPlaceholderFrame(frame, static_cast<size_t>(info.size), info))
+            continue; // no audio, the tag never goes over it in segments
+
+        if (duration > 0 && duration + frameSeconds > segmentSeconds + 1e-9)
+            isOk = cut();
+
+        if (!segment.is_open()) {
+            isOk = isOk && makeDir(dir.c_str());
+            segment.open(dir + "/" + segmentName(durations.size()), std::ios_base::binary | std::ofstream::out);
+        }
+
+        segment.write(reinterpret_cast<char const*>(frame), info.size);
+        duration += frameSeconds;
+        isOk      = isOk && static_cast<bool>(segment);
+    }
+
+    return isOk;
+}
+
+
+// finish the segment being written and list it
+bool HlsSegmenter::cut()
+{
+    segment.close();
+
+    if (!segment)
+        return false;
+
+    durations.push_back(duration);
+    duration = 0;
+    return writePlaylist(false);
+}
+
+
+bool HlsSegmenter::finish()
+{
+    if (isOk && duration > 0)
+        isOk = cut();
+
+    return isOk && writePlaylist(true);
+}
+
+
+void HlsSegmenter::remove(string const& dir)
+{
+    size_t idx = 0;
+    while (::remove((dir + "/" + segmentName(idx)).c_str()) == 0) // written in order, the first missing one is the end
+        ++idx;
+
+    for (auto const name : { "/playlist.m3u8", "/playlist.m3u8.tmp" })
+        ::remove((dir + name).c_str());
+    ::remove(dir.c_str()); // empty by now
+}
+
+
+// written aside and renamed over, a player never reads half a playlist
+bool HlsSegmenter::writePlaylist(bool isEnded) const
+{
+    auto const    name    = playlistName();
+    auto const    tmpName = name + ".tmp";
+    std::ofstream playlist(tmpName);
+
+    playlist << "#EXTM3U\n"
+             << "#EXT-X-VERSION:3\n"
+             << "#EXT-X-TARGETDURATION:" << static_cast<int32_t>(std::ceil(segmentSeconds)) << "\n"
+             << "#EXT-X-MEDIA-SEQUENCE:0\n"
+             << "#EXT-X-PLAYLIST-TYPE:" << (isEnded ? "VOD" : "EVENT") << "\n"
+             << std::fixed << std::setprecision(3);
+
+    for (size_t idx = 0; idx < durations.size(); ++idx)
+        playlist << "#EXTINF:" << durations[idx] << ",\n" << segmentName(idx) << "\n";
+
+    if (isEnded)
+        playlist << "#EXT-X-ENDLIST\n";
+
+    playlist.close();
+#if !(defined (__linux__) || defined (__linux) || defined (__gnu_linux__))
+    ::remove(name.c_str()); // Windows doesn't rename over a file
+#endif
+    return playlist && ::rename(tmpName.c_str(), name.c_str()) == 0;
+}
@@ -0,0 +1,50 @@
+#ifndef HLS_H
+#define HLS_H
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mp3frame.hpp"
+
+// writes an MP3 stream as frame aligned segments of at most segmentSeconds,
+// dir/00000.mp3, dir/00001.mp3 ..., and rewrites dir/playlist.m3u8 as each
+// segment is finished so players can start before the encoding is done
+class HlsSegmenter
+{
+public:
+    HlsSegmenter(std::string const& dir, double segmentSeconds);
+
+    // the stream starts with the encoder's tag placeholder, which segments never get
+    // written over, so it's left out; before the first write()
+    void setTagFirst(bool isTagFirst) { this->isTagFirst = isTagFirst; }
+
+    // MP3 data as the encoder returns it, false on a write error
+    bool write(uint8_t const* data, size_t size);
+
+    // finish the last segment and close the playlist
+    bool finish();
+
+    std::string playlistName() const { return dir + "/playlist.m3u8"; }
+
+    // the segments, playlist and folder of a stream cut short
+    static void remove(std::string const& dir);
+
+private:
+    bool cut();
+    bool writePlaylist(bool isEnded) const;
+    static std::string segmentName(size_t idx);
+
+    std::string         dir;
+    double              segmentSeconds;
+    Mp3FrameSplitter    splitter;
+    std::ofstream       segment;
+    double              duration   = 0; // of the segment being written
+    std::vector<double> durations;      // of the finished segments
+    bool                isTagFirst = false;
+    bool                isStarted  = false; // past the first frame, the only one that may be the tag
+    bool                isOk       = true;
+};
+
+#endif // HLS_H
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "filesystem.hpp"
+#include "hosttokens.hpp"
+
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using std::string;
+using Clock = std::chrono::steady_clock;
+
+static const constexpr auto MIN_WAIT_STEP = std::chrono::milliseconds(5);
+static const constexpr auto MAX_WAIT_STEP = std::chrono::milliseconds(100);
+
+static string                tokenDir;
+static size_t                tokenNum = 0;
+static std::atomic<uint64_t> waitMicros(0);
+static thread_local int      heldFd   = -1; // slot file locked by this thread
+
+
+string defaultHostTokenDir()
+{
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+    struct stat info;
+    if (::stat("/dev/shm", &info) == 0 && S_ISDIR(info.st_mode))
+        return "/dev/shm/encode2mp3.cpus";
+#endif
+    return "/tmp/encode2mp3.cpus";
+}
+
+
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+
+bool setHostTokens(string const& dir, size_t tokens, string& error)
+{
+    if (!makeDir(dir.c_str())) {
+        error = "can't make host token folder " + dir;
+        return false;
+    }
+
+    for (size_t slot = 0; slot < tokens; ++slot) { // all there up front, so a missing one is an error here, not a hang
+        auto const name = dir + "/slot." + std::to_string(slot);
+        auto const fd   = ::open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+
+        if (fd < 0) {
+            error = "can't open host token slot " + name;
+            return false;
+        }
+        ::close(fd);
+    }
+
+    tokenDir = dir;
+    tokenNum = tokens;
+    return true;
+}
+
+
+// try the slots once, from a different one in every process so they don't all
+// line up on slot 0
+static bool tryAcquire()
+{
+    auto const first = static_cast<size_t>(::getpid());
+
+    for (size_t idx = 0; idx < tokenNum; ++idx) {
+        auto const name = tokenDir + "/slot." + std::to_string((first + idx) % tokenNum);
+        auto const fd   = ::open(name.c_str(), O_RDWR | O_CLOEXEC); // own open file description, flock() is per one
+
+        if (fd < 0)
+            continue;
+
+        if (::flock(fd, LOCK_EX | LOCK_NB) == 0) {
+            heldFd = fd;
+            return true;
+        }
+
+        ::close(fd);
+    }
+
+    return false;
+}
+
+
+void acquireHostToken()
+{
+    if (tokenNum == 0 || heldFd >= 0 || tryAcquire())
+        return;
+
+    auto const start = Clock::now();
+
+    for (auto step = MIN_WAIT_STEP; !tryAcquire(); step = std::min(step * 2, MAX_WAIT_STEP))
+        std::this_thread::sleep_for(step);
+
+    waitMicros += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+}
+
+
+void releaseHostToken()
+{
+    if (heldFd < 0)
+        return;
+
+    ::close(heldFd); // drops the lock
+    heldFd = -1;
+}
+
+#else // no flock(), no coordination
+
+bool setHostTokens(string const&, size_t, string& error)
+{
+    error = "host CPU tokens need flock()";
+    return false;
+}
+
+
+void acquireHostToken() {}
+void releaseHostToken() {}
+
+#endif
+
+
+bool isHostTokens()
+{
+    return tokenNum > 0;
+}
+
+
+double hostTokenWaitSeconds()
+{
+    return waitMicros / 1e6;
+}
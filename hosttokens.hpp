@@ -0,0 +1,26 @@
+#ifndef HOSTTOKENS_H
+#define HOSTTOKENS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// CPU tokens shared by all encode2mp3 processes on the host: a table of slot
+// files, a token is an flock() on one of them, so tokens of a process that
+// dies come back by themselves; every process has to use the same count
+
+// opt in for this process, tokens slot files in dir (made if missing), false with error set
+bool setHostTokens(std::string const& dir, size_t tokens, std::string& error);
+bool isHostTokens();
+
+// take a token for the calling thread, waits until one is free; no-op without
+// setHostTokens() or if the thread has one already
+void acquireHostToken();
+void releaseHostToken(); // the calling thread's, if it has one
+
+double hostTokenWaitSeconds(); // all threads together
+
+// default slot table folder, in /dev/shm where there is one
+std::string defaultHostTokenDir();
+
+#endif // HOSTTOKENS_H
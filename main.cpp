@@ -0,0 +1,193 @@
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "encode2mp3.hpp"
+#include "encoder.hpp"
+#include "filesystem.hpp"
+#include "hosttokens.hpp"
+#include "options.hpp"
+#include "pool.hpp"
+#include "procpool.hpp"
+#include "shmring.hpp"
+#include "throttle.hpp"
+
+using std::vector;
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+
+// one manifest per output folder listing every file encoded there:
+// CRC32C of input PCM, CRC32C of output MP3, MP3 size and MP3 file name
+static void writeManifests(vector<JobResult> const& results)
+{
+    std::map<string, vector<JobResult const*>> byDir;
+
+    for (auto const& result : results) {
+        if (!result.isEncoded)
+            continue;
+
+        auto const slashPos = result.outFileName.find_last_of("/\\");
+        byDir[result.outFileName.substr(0, slashPos + 1)].push_back(&result);
+    }
+
+    for (auto const& dir : byDir) {
+        auto const manifestName = dir.first + "encode2mp3.manifest";
+        std::ofstream manifest(manifestName, std::ofstream::out);
+        manifest << "# pcm-crc32c mp3-crc32c mp3-bytes file\n" << std::hex << std::setfill('0');
+
+        for (auto const result : dir.second)
+            manifest << std::setw(8) << result->pcmCrc << ' ' << std::setw(8) << result->mp3Crc << ' '
+                     << std::dec << result->mp3Bytes << std::hex << ' '
+                     << result->outFileName.substr(dir.first.size()) << '\n';
+
+        if (!manifest.flush())
+            cerr << "ERROR! Can't write manifest " << manifestName << endl;
+    }
+}
+
+
+static void printSummary(Options const& options, vector<Job> const& jobs, vector<JobResult> const& results)
+{
+    auto const& inputs = options.inputs;
+
+    cout << "Summary:\n";
+
+    for (size_t root = 0; root < inputs.size(); ++root) {
+        size_t files     = 0;
+        size_t encoded   = 0;
+        size_t dualMono  = 0;
+        size_t silent    = 0;
+        size_t resampled = 0;
+        size_t speech    = 0;
+        double seconds   = 0;
+
+        for (size_t idx = 0; idx < jobs.size(); ++idx) {
+            if (jobs[idx].root != root)
+                continue;
+
+            ++files;
+            encoded   += results[idx].isEncoded ? 1 : 0;
+            dualMono  += results[idx].isEncoded && results[idx].isDualMono ? 1 : 0;
+            silent    += results[idx].isSilent ? 1 : 0;
+            resampled += results[idx].isEncoded && results[idx].outSampleRate < results[idx].inSampleRate ? 1 : 0;
+            speech    += results[idx].isEncoded && results[idx].isSpeech ? 1 : 0;
+            seconds   += results[idx].audioSeconds;
+        }
+
+        cout << "  " << inputs[root] << ": " << encoded << " of " << files << " files encoded, "
+             << std::fixed << std::setprecision(1) << seconds << " s of audio";
+
+        if (dualMono > 0)
+            cout << ", " << dualMono << " dual mono encoded as mono";
+
+        if (silent > 0)
+            cout << ", " << silent << (options.silenceMode == SilenceMode::Skip ? " silent skipped" : " silent written as silent frames");
+
+        if (speech > 0)
+            cout << ", " << speech << " speech";
+
+        if (resampled > 0)
+            cout << ", " << resampled << " at a lower sample rate";
+
+        cout << "\n";
+    }
+
+    if (isIoLimited() && options.processNum == 0) // waits of worker processes are theirs
+        cout << "  time throttled: " << std::fixed << std::setprecision(1)
+             << readThrottledSeconds() << " s reading, " << writeThrottledSeconds() << " s writing\n";
+
+    if (isHostTokens() && options.processNum == 0)
+        cout << "  time waiting for host CPU tokens: " << std::fixed << std::setprecision(1) << hostTokenWaitSeconds() << " s\n";
+}
+
+
+static void printExtentionsMsg()
+{
+    cout << "Supported file extentions: ";
+    for (auto const& ext : inputExtentions())
+        cout << '.' << ext << " ";
+    cout << "\n";
+}
+
+
+int main(int argNum, char** args)
+{
+    printExtentionsMsg();
+    Options options;
+
+    if (!parseOptions(argNum, args, options)) {
+        printUsage();
+        return -1;
+    }
+
+    if (options.processNum > 0 && !isProcessPoolSupported()) {
+        cerr << "ERROR! Worker processes (--processes) are supported on Linux only\n";
+        return -1;
+    }
+
+    for (auto const& input : options.inputs) {
+        PathName   pathName;
+        bool const isPath = input[0] != '@' && !isShmInput(input);
+
+        if (isShmInput(input) && !isShmRingSupported()) {
+            cerr << "ERROR! Shared memory inputs are supported on Linux only: " << input << endl;
+            return -1;
+        }
+
+        if (isPath && !statPath(input.c_str(), pathName) && !checkPath(input.c_str())) {
+            cerr << "ERROR! UNIX console detected! Please, use '/' or '\\\\' path separators instead of '\\'\n";
+            return -1;
+        }
+    }
+
+    auto const jobs = collectJobs(options);
+
+    if (jobs.empty()) {
+        cerr << "An error happened or the inputs don't exist or have no supported files!\n";
+        return -1;
+    }
+
+    if (!options.packFile.empty())
+        return packJobs(jobs, options);
+
+    for (auto const& job : jobs)
+        if (!isEncoderAvailable(job.encoder)) {
+            cerr << "Error: the " << encoderName(job.encoder) << " encoder isn't built in, it needs libshine!\n";
+            return -1;
+        }
+
+    auto const workerNum = options.workerNum > 0 ? options.workerNum : defaultWorkerNum();
+    cout << "Found " << jobs.size() << " files to encode\n";
+
+    auto const ioShares = static_cast<double>(std::max<size_t>(options.processNum, 1)); // each worker process limits itself
+    setIoLimits(options.maxReadMBps * 1e6 / ioShares, options.maxWriteMBps * 1e6 / ioShares, options.maxIops / ioShares, options.ioBurstMs / 1000.0);
+
+    string error;
+    if (options.hostCpus > 0 && !setHostTokens(defaultHostTokenDir(), options.hostCpus, error)) {
+        cerr << "ERROR! " << error << endl;
+        return -1;
+    }
+
+    if (options.isScalingBench) {
+        runScalingBench(jobs, options, workerNum);
+        return 0;
+    }
+
+    if (options.isEncoderBench) {
+        runEncoderBench(jobs, options);
+        return 0;
+    }
+
+    auto const results = encodeJobs(jobs, options);
+    printSummary(options, jobs, results);
+
+    if (options.isManifest)
+        writeManifests(results);
+    return 0;
+}
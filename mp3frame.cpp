@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <string.h>
+
+#include "mp3frame.hpp"
+
+using std::vector;
+
+namespace
+{
+enum MpegVersion : uint8_t { Mpeg25 = 0, Reserved = 1, Mpeg2 = 2, Mpeg1 = 3 }; // header bits 19-20
+
+int32_t const SAMPLE_RATES[4][3] = {
+    { 11025, 12000,  8000 }, // MPEG-2.5
+    {     0,     0,     0 },
+    { 22050, 24000, 16000 }, // MPEG-2
+    { 44100, 48000, 32000 }, // MPEG-1
+};
+
+int32_t const BITRATES[2][15] = { // layer III, kbps
+    { 0,  8, 16, 24, 32, 40, 48, 56,  64,  80,  96, 112, 128, 144, 160 }, // MPEG-2 and 2.5
+    { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 }, // MPEG-1
+};
+}
+
+
+static int32_t frameSize(uint8_t version, int32_t bitrate, int32_t sampleRate, int32_t padding)
+{
+    return (version == Mpeg1 ? 144000 : 72000) * bitrate / sampleRate + padding;
+}
+
+
+bool parseMp3FrameHeader(uint8_t const* h, Mp3FrameInfo& info)
+{
+    if (h[0] != 0xff || (h[1] & 0xe0) != 0xe0)
+        return false; // no sync
+
+    uint8_t const version      = (h[1] >> 3) & 3;
+    uint8_t const layer        = (h[1] >> 1) & 3;
+    uint8_t const bitrateIdx   = h[2] >> 4;
+    uint8_t const rateIdx      = (h[2] >> 2) & 3;
+    uint8_t const padding      = (h[2] >> 1) & 1;
+    uint8_t const mode         = h[3] >> 6;
+
+    if (version == Reserved || layer != 1 || bitrateIdx == 0 || bitrateIdx == 15 || rateIdx == 3)
+        return false; // not layer III or free format
+
+    info.sampleRate = SAMPLE_RATES[version][rateIdx];
+    info.bitrate    = BITRATES[version == Mpeg1 ? 1 : 0][bitrateIdx];
+    info.channels   = mode == 3 ? 1 : 2;
+    info.size       = frameSize(version, info.bitrate, info.sampleRate, padding);
+    info.samples    = version == Mpeg1 ? 1152 : 576;
+    return true;
+}
+
+
+vector<uint8_t> makeSilentMp3Frame(int32_t sampleRate, int32_t channels)
+{
+    for (uint8_t version : { Mpeg1, Mpeg2, Mpeg25 }) {
+        for (uint8_t rateIdx = 0; rateIdx < 3; ++rateIdx) {
+            if (SAMPLE_RATES[version][rateIdx] != sampleRate)
+                continue;
+
+            bool const isMono    = channels == 1;
+            auto const bitrate   = BITRATES[version == Mpeg1 ? 1 : 0][1];
+            vector<uint8_t> frame(frameSize(version, bitrate, sampleRate, 0), 0); // side info and main data all zero
+
+            frame[0] = 0xff;
+            frame[1] = static_cast<uint8_t>(0xe0 | version << 3 | 1 << 1 | 1); // layer III, no CRC
+            frame[2] = static_cast<uint8_t>(1 << 4 | rateIdx << 2);              // lowest bitrate, no padding
+            frame[3] = isMono ? 0xc0 : 0x00;                                     // mono or plain stereo
+            return frame;
+        }
+    }
+
+    return {};
+}
+
+
+bool isInfoTagFrame(uint8_t const* frame, Mp3FrameInfo const& info)
+{
+    const constexpr int32_t TAG_END = 4 + 2 + 32 + 4; // header, CRC, longest side info, tag id
+
+    for (int32_t pos = 4; pos + 4 <= std::min(info.size, TAG_END); ++pos)
+        if (::memcmp(frame + pos, "Xing", 4) == 0 || ::memcmp(frame + pos, "Info", 4) == 0)
+            return true;
+
+    return false;
+}
+
+
+bool isTagPlaceholderFrame(uint8_t const* frame, size_t size, Mp3FrameInfo const& info)
+{
+    if (info.size < 4 || size < static_cast<size_t>(info.size))
+        return false;
+
+    return std::all_of(frame + 4, frame + info.size, [](uint8_t byte) { return byte == 0; }) || isInfoTagFrame(frame, info);
+}
+
+
+void Mp3FrameSplitter::add(uint8_t const* data, size_t size)
+{
+    buffer.erase(buffer.begin(), buffer.begin() + first);
+    erased += first;
+    buffer.insert(buffer.end(), data, data + size);
+    first = 0;
+}
+
+
+bool Mp3FrameSplitter::next(uint8_t const*& frame, Mp3FrameInfo& info)
+{
+    for (; buffer.size() - first >= 4; ++first) {
+        if (!parseMp3FrameHeader(buffer.data() + first, info))
+            continue;
+
+        if (buffer.size() - first < static_cast<size_t>(info.size)) // rest comes with the next add()
+            return false;
+
+        frame  = buffer.data() + first;
+        first += info.size;
+        return true;
+    }
+
+    return false;
+}
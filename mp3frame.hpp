@@ -0,0 +1,53 @@
+#ifndef MP3FRAME_H
+#define MP3FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// MPEG audio layer III frame header fields
+struct Mp3FrameInfo
+{
+    int32_t sampleRate = 0;
+    int32_t bitrate    = 0; // kbps
+    int32_t channels   = 0;
+    int32_t size       = 0; // bytes, header included
+    int32_t samples    = 0; // per channel: 1152 for MPEG-1, 576 for MPEG-2 and 2.5
+};
+
+// parse 4 header bytes, false if they aren't a valid layer III header
+bool parseMp3FrameHeader(uint8_t const* header, Mp3FrameInfo& info);
+
+// lowest bitrate frame decoding to digital silence: all side info is zero,
+// so there are no spectral values and no bit reservoir use, any number of
+// these frames is a valid stream; empty for sample rates MPEG doesn't have
+std::vector<uint8_t> makeSilentMp3Frame(int32_t sampleRate, int32_t channels);
+
+// first frame holding a Xing/Info tag instead of audio, players skip it
+bool isInfoTagFrame(uint8_t const* frame, Mp3FrameInfo const& info);
+
+// first frame lame keeps for its Info tag until the stream is flushed: the
+// header and zeros, no tag id yet; a frame with a tag counts too. size bytes
+// of frame are there, false if that's less than the frame
+bool isTagPlaceholderFrame(uint8_t const* frame, size_t size, Mp3FrameInfo const& info);
+
+// cuts an MP3 stream written in pieces of any size into whole frames,
+// bytes which aren't a frame header are skipped
+class Mp3FrameSplitter
+{
+public:
+    void add(uint8_t const* data, size_t size);
+
+    // next whole frame added so far, valid until the next add()
+    bool next(uint8_t const*& frame, Mp3FrameInfo& info);
+
+    // byte offset in the stream of a frame next() returned
+    uint64_t offsetOf(uint8_t const* frame) const { return erased + static_cast<uint64_t>(frame - buffer.data()); }
+
+private:
+    std::vector<uint8_t> buffer;
+    size_t               first  = 0; // start of the first frame not handed out
+    uint64_t             erased = 0; // stream bytes before buffer
+};
+
+#endif // MP3FRAME_H
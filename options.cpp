@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "bundle.hpp"
+#include "options.hpp"
+
+using std::cerr;
+using std::string;
+using std::vector;
+
+
+// parse a positive decimal number, whole text must be a number
+static bool parseCount(char const* text, size_t& value)
+{
+    if (!text || !*text || *text == '-')
+        return false;
+
+    char* end = nullptr;
+    errno = 0;
+    auto const parsed = ::strtoul(text, &end, 10);
+
+    if (errno != 0 || *end != '\0' || parsed == 0)
+        return false;
+
+    value = parsed;
+    return true;
+}
+
+
+// parse a positive decimal number with an optional fraction
+static bool parseRate(char const* text, double& value)
+{
+    if (!text || !*text)
+        return false;
+
+    char* end = nullptr;
+    errno = 0;
+    auto const parsed = ::strtod(text, &end);
+
+    if (errno != 0 || *end != '\0' || !(parsed > 0))
+        return false;
+
+    value = parsed;
+    return true;
+}
+
+
+// [[h:]m:]s[.fff], not negative
+static bool parseTime(string const& text, double& seconds)
+{
+    seconds = 0;
+    size_t first = 0;
+
+    for (int32_t part = 0; part < 3; ++part) {
+        auto const colon = text.find(':', first);
+        auto const item  = text.substr(first, colon == string::npos ? string::npos : colon - first);
+        char*      end   = nullptr;
+
+        if (item.empty() || item[0] == '-' || item[0] == '+')
+            return false;
+
+        errno = 0;
+        auto const value = ::strtod(item.c_str(), &end);
+
+        if (errno != 0 || *end != '\0' || !(value >= 0))
+            return false;
+
+        seconds = seconds * 60 + value;
+
+        if (colon == string::npos)
+            return true;
+
+        first = colon + 1;
+    }
+
+    return false;
+}
+
+
+// input,start,end[,output] per line, paths relative to the list, empty end - up to the end
+static bool readRangeList(string const& listName, size_t root, vector<RangeJob>& rangeJobs)
+{
+    auto const slashPos = listName.find_last_of("/\\");
+    auto const listDir  = slashPos == string::npos ? string() : listName.substr(0, slashPos + 1);
+    std::ifstream list(listName);
+    string line;
+
+    if (!list) {
+        cerr << "Error: can't open range list " << listName << "\n";
+        return false;
+    }
+
+    for (size_t lineNum = 1; std::getline(list, line); ++lineNum) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        vector<string> fields;
+        for (size_t first = 0, comma = 0; comma != string::npos; first = comma + 1) {
+            comma = line.find(',', first);
+            fields.push_back(line.substr(first, comma == string::npos ? string::npos : comma - first));
+        }
+
+        RangeJob rangeJob;
+        rangeJob.root = root;
+
+        EncoderKind encoder;
+
+        if (fields.size() < 3 || fields.size() > 5 || fields[0].empty()
+            || (!fields[1].empty() && !parseTime(fields[1], rangeJob.start))
+            || (!fields[2].empty() && !parseTime(fields[2], rangeJob.end))
+            || (rangeJob.end > 0 && rangeJob.end <= rangeJob.start)
+            || (fields.size() == 5 && !fields[4].empty() && !parseEncoder(fields[4], encoder))) {
+            cerr << "Error: " << listName << ":" << lineNum << " isn't input,start,end[,output[,encoder]]\n";
+            return false;
+        }
+
+        auto const isAbsolute = [](string const& path) { return path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':'); };
+        rangeJob.input = isAbsolute(fields[0]) ? fields[0] : listDir + fields[0];
+
+        if (fields.size() >= 4 && !fields[3].empty())
+            rangeJob.outName = isAbsolute(fields[3]) ? fields[3] : listDir + fields[3];
+
+        if (fields.size() == 5)
+            rangeJob.encoder = fields[4];
+
+        rangeJobs.push_back(rangeJob);
+    }
+
+    return true;
+}
+
+
+// comma separated mono, stereo, bitrate=N, quality=N, samplerate=N
+static bool parsePreset(string const& text, Preset& preset)
+{
+    int32_t const rates[] = { 8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000 };
+
+    preset = Preset();
+    size_t first = 0;
+
+    while (first < text.size()) {
+        auto       last  = text.find(',', first);
+        last             = last == string::npos ? text.size() : last;
+        auto const item  = text.substr(first, last - first);
+        auto const equal = item.find('=');
+        auto const key   = item.substr(0, equal);
+        size_t     value = 0;
+        first = last + 1;
+
+        if (item == "mono" || item == "stereo") {
+            preset.isMono = item == "mono";
+            continue;
+        }
+
+        if (equal == string::npos)
+            return false;
+
+        bool const isZero = item.substr(equal + 1) == "0";
+        if (!isZero && !parseCount(item.c_str() + equal + 1, value))
+            return false;
+
+        if (key == "bitrate" && value >= 8 && value <= 320)
+            preset.bitrate = static_cast<int32_t>(value);
+        else if (key == "quality" && value <= 9)
+            preset.quality = static_cast<int32_t>(value);
+        else if (key == "samplerate" && std::find(std::begin(rates), std::end(rates), value) != std::end(rates))
+            preset.sampleRate = static_cast<int32_t>(value);
+        else
+            return false;
+    }
+
+    return true;
+}
+
+
+bool parseEncoder(string const& name, EncoderKind& encoder)
+{
+    if (name != "lame" && name != "fast")
+        return false;
+
+    encoder = name == "fast" ? EncoderKind::Fast : EncoderKind::Lame;
+    return true;
+}
+
+
+void printUsage()
+{
+    cerr << "Usage: encode2mp3 [options] input...\n"
+            "Inputs are folders, WAV files, @file_list (one folder or file per line) or\n"
+            "shm:/name[=out.mp3] and shm:#fd[=out.mp3] shared memory PCM rings\n"
+            "Options:\n"
+            "  --jobs N           encode with N worker threads (default: one per CPU core)\n"
+            "  --adaptive MIN,MAX tune the number of active workers between MIN and MAX on measured\n"
+            "                     throughput and I/O wait, starting from --jobs\n"
+            "  --processes N      encode in N worker processes instead of threads, a worker that\n"
+            "                     crashes fails only its file and is replaced by a new one\n"
+            "  --scaling-bench    encode the inputs with 1, 2, 4 ... N workers and report scaling\n"
+            "  --bitrate N        constant bitrate in kbps (default: 128)\n"
+            "  --transcode        also accept MP3 inputs, each is decoded and re-encoded to\n"
+            "                     name.<bitrate>k.mp3 next to the source\n"
+            "  --peaks N          write waveform peaks (min/max of every N samples) next to the MP3\n"
+            "  --peaks-levels L   number of peak resolutions, each next is 4 times coarser (default: 3)\n"
+            "  --peaks-format F   bin (default) or json\n"
+            "  --manifest         write CRC32C of input PCM and output MP3 of every file to\n"
+            "                     encode2mp3.manifest in each output folder\n"
+            "  --max-read-mbps R  limit reading of all workers together to R MB/s\n"
+            "  --max-write-mbps W limit writing of all workers together to W MB/s\n"
+            "  --max-iops N       limit read and write calls of all workers together to N per second\n"
+            "  --io-burst-ms T    unused limit budget of up to T ms may be spent at once (default: 250)\n"
+            "  --background       run encoding threads at idle CPU and I/O priority\n"
+            "  --host-cpus N      share N CPU tokens with all other encode2mp3 processes on the host\n"
+            "                     started with the same N, a job runs only while it holds one\n"
+            "  --dual-mono T      encode stereo files as mono while |L - R| stays within T (0 - exact)\n"
+            "  --silence P        files with no sample above the silence threshold aren't encoded,\n"
+            "                     P is frames (write silent MP3 frames) or skip (no output)\n"
+            "  --silence-threshold T  largest |sample| still counted as silence (default: 0)\n"
+            "  --auto-samplerate  encode at the lowest sample rate keeping the measured bandwidth\n"
+            "  --classify         tell speech from music in every WAV file and encode with its preset\n"
+            "  --speech-preset P  comma separated mono, stereo, bitrate=N, quality=N, samplerate=N\n"
+            "                     (default: mono,bitrate=48,quality=7,samplerate=16000)\n"
+            "  --music-preset P   same for music (default: the other options)\n"
+            "  --start T          encode from time T, [[h:]m:]s[.fff] (default: 0)\n"
+            "  --end T            encode up to time T (default: up to the end)\n"
+            "  --ranges FILE      encode the parts listed in a CSV file, input,start,end[,output[,encoder]]\n"
+            "                     per line, output defaults to name.<start>-<end>.mp3\n"
+            "  --follow           keep encoding WAV files that are still being recorded until the\n"
+            "                     writer closes them with the final size in the header\n"
+            "  --follow-timeout T a followed file not growing for T seconds is done (default: 60)\n"
+            "  --hls S            write name.hls/ with S second MP3 segments and playlist.m3u8\n"
+            "                     instead of name.mp3, the playlist grows with every segment\n"
+            "  --seek-index N     write byte offset and sample position of every Nth MP3 frame\n"
+            "                     to name.seek next to the MP3\n"
+            "  --split N          encode each file in up to N pieces on threads of its own, cuts the\n"
+            "                     wall time of a single long file, MP3 isn't bit identical to a\n"
+            "                     whole file encode (no bit reservoir, no Info tag)\n"
+            "  --encoder E        lame (default) or fast, a fixed-point encoder for previews,\n"
+            "                     several times faster at lower quality (needs a build with libshine)\n"
+            "  --encoder-bench    encode the inputs in memory with every built in encoder on one\n"
+            "                     thread and report their throughput\n"
+            "  --pack FILE        pack the inputs into the bundle FILE (name.e2mb) instead of encoding\n"
+            "                     them; name.e2mb inputs are encoded clip by clip into the folder name/\n";
+}
+
+
+// fill options from the command line, print an error and return false on bad input
+bool parseOptions(int argNum, char** args, Options& options)
+{
+    for (int idx = 1; idx < argNum; ++idx) {
+        string const arg = args[idx];
+
+        if (arg == "--scaling-bench")
+            options.isScalingBench = true;
+        else if (arg == "--encoder-bench")
+            options.isEncoderBench = true;
+        else if (arg == "--background")
+            options.isBackground = true;
+        else if (arg == "--follow")
+            options.isFollow = true;
+        else if (arg == "--auto-samplerate")
+            options.isAutoSampleRate = true;
+        else if (arg == "--manifest")
+            options.isManifest = true;
+        else if (arg == "--transcode")
+            options.isTranscode = true;
+        else if (arg == "--bitrate") {
+            size_t bitrate = 0;
+
+            if (++idx == argNum || !parseCount(args[idx], bitrate) || bitrate < 8 || bitrate > 320) {
+                cerr << "Error: --bitrate expects kbps from 8 to 320!\n";
+                return false;
+            }
+
+            options.bitrate = static_cast<int32_t>(bitrate);
+        }
+        else if (arg == "--host-cpus") {
+            if (++idx == argNum || !parseCount(args[idx], options.hostCpus) || options.hostCpus > 4096) {
+                cerr << "Error: --host-cpus expects a positive number!\n";
+                return false;
+            }
+        }
+        else if (arg == "--jobs") {
+            if (++idx == argNum || !parseCount(args[idx], options.workerNum)) {
+                cerr << "Error: --jobs expects a positive number!\n";
+                return false;
+            }
+        }
+        else if (arg == "--processes") {
+            if (++idx == argNum || !parseCount(args[idx], options.processNum) || options.processNum > 1024) {
+                cerr << "Error: --processes expects a number from 1 to 1024!\n";
+                return false;
+            }
+        }
+        else if (arg == "--adaptive") {
+            string const bounds = ++idx < argNum ? args[idx] : "";
+            auto const   comma  = bounds.find(',');
+
+            if (comma == string::npos || !parseCount(bounds.substr(0, comma).c_str(), options.minWorkers)
+                || !parseCount(bounds.c_str() + comma + 1, options.maxWorkers) || options.maxWorkers < options.minWorkers) {
+                cerr << "Error: --adaptive expects MIN,MAX worker numbers!\n";
+                return false;
+            }
+        }
+        else if (arg == "--split") {
+            size_t pieceNum = 0;
+
+            if (++idx == argNum || !parseCount(args[idx], pieceNum) || pieceNum > 64) {
+                cerr << "Error: --split expects a number of pieces from 1 to 64!\n";
+                return false;
+            }
+
+            options.splitNum = static_cast<int32_t>(pieceNum);
+        }
+        else if (arg == "--peaks" || arg == "--peaks-levels" || arg == "--seek-index") {
+            size_t value = 0;
+
+            if (++idx == argNum || !parseCount(args[idx], value) || value > (arg == "--peaks-levels" ? 8u : 1u << 20)) {
+                cerr << "Error: " << arg << " expects a positive number!\n";
+                return false;
+            }
+
+            (arg == "--peaks" ? options.peakSamples : arg == "--seek-index" ? options.seekIndexFrames : options.peakLevels) = static_cast<int32_t>(value);
+        }
+        else if (arg == "--max-read-mbps" || arg == "--max-write-mbps" || arg == "--max-iops" || arg == "--io-burst-ms"
+                 || arg == "--follow-timeout" || arg == "--hls") {
+            auto& value = arg == "--max-read-mbps"  ? options.maxReadMBps
+                        : arg == "--max-write-mbps" ? options.maxWriteMBps
+                        : arg == "--max-iops"       ? options.maxIops
+                        : arg == "--io-burst-ms"    ? options.ioBurstMs
+                        : arg == "--hls"            ? options.hlsSegmentSeconds
+                        :                             options.followTimeout;
+
+            if (++idx == argNum || !parseRate(args[idx], value)) {
+                cerr << "Error: " << arg << " expects a positive number!\n";
+                return false;
+            }
+        }
+        else if (arg == "--dual-mono" || arg == "--silence-threshold") {
+            size_t threshold = 0;
+            bool const isZero = ++idx < argNum && string(args[idx]) == "0";
+
+            if (idx == argNum || (!isZero && !parseCount(args[idx], threshold)) || threshold > 32767) {
+                cerr << "Error: " << arg << " expects a sample value from 0 to 32767!\n";
+                return false;
+            }
+
+            (arg == "--dual-mono" ? options.dualMonoThreshold : options.silenceThreshold) = static_cast<int32_t>(threshold);
+        }
+        else if (arg == "--silence") {
+            string const mode = ++idx < argNum ? args[idx] : "";
+
+            if (mode != "frames" && mode != "skip") {
+                cerr << "Error: --silence expects frames or skip!\n";
+                return false;
+            }
+
+            options.silenceMode = mode == "skip" ? SilenceMode::Skip : SilenceMode::Frames;
+        }
+        else if (arg == "--classify")
+            options.isClassify = true;
+        else if (arg == "--speech-preset" || arg == "--music-preset") {
+            auto& preset = arg == "--speech-preset" ? options.speechPreset : options.musicPreset;
+
+            if (++idx == argNum || !parsePreset(args[idx], preset)) {
+                cerr << "Error: " << arg << " expects mono, stereo, bitrate=8..320, quality=0..9, samplerate=<MPEG rate>!\n";
+                return false;
+            }
+        }
+        else if (arg == "--start" || arg == "--end") {
+            if (++idx == argNum || !parseTime(args[idx], arg == "--start" ? options.startSeconds : options.endSeconds)) {
+                cerr << "Error: " << arg << " expects a time as [[h:]m:]s[.fff]!\n";
+                return false;
+            }
+        }
+        else if (arg == "--ranges") {
+            if (++idx == argNum) {
+                cerr << "Error: --ranges expects a CSV file!\n";
+                return false;
+            }
+
+            options.rangeLists.push_back(options.inputs.size());
+            options.inputs.push_back(args[idx]);
+
+            if (!readRangeList(args[idx], options.rangeLists.back(), options.rangeJobs))
+                return false;
+        }
+        else if (arg == "--pack") {
+            if (++idx == argNum || !isBundleName(args[idx])) {
+                cerr << "Error: --pack expects a name.e2mb file!\n";
+                return false;
+            }
+
+            options.packFile = args[idx];
+        }
+        else if (arg == "--encoder") {
+            if (++idx == argNum || !parseEncoder(args[idx], options.encoder)) {
+                cerr << "Error: --encoder expects lame or fast!\n";
+                return false;
+            }
+        }
+        else if (arg == "--peaks-format") {
+            string const format = ++idx < argNum ? args[idx] : "";
+
+            if (format != "bin" && format != "json") {
+                cerr << "Error: --peaks-format expects bin or json!\n";
+                return false;
+            }
+
+            options.isPeaksJson = format == "json";
+        }
+        else if (arg.compare(0, 2, "--") == 0) {
+            cerr << "Error: unknown option " << arg << "\n";
+            return false;
+        }
+        else
+            options.inputs.push_back(arg);
+    }
+
+    if (options.inputs.empty()) {
+        cerr << "Error: nothing to encode specified!\n";
+        return false;
+    }
+
+    if (options.endSeconds > 0 && options.endSeconds <= options.startSeconds) {
+        cerr << "Error: --end has to be after --start!\n";
+        return false;
+    }
+
+    return true;
+}
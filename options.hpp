@@ -0,0 +1,77 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum class SilenceMode : uint8_t { Off, Frames, Skip };
+enum class EncoderKind : uint8_t { Lame, Fast }; // see encoder.hpp
+
+// encoder settings for a class of content, 0 or -1 - the general options decide
+struct Preset
+{
+    bool    isMono     = false; // downmix stereo
+    int32_t bitrate    = 0;
+    int32_t quality    = -1;    // lame's 0 (best) .. 9 (fastest)
+    int32_t sampleRate = 0;     // MP3 sample rate
+};
+
+// part of a file to encode, a line of a --ranges list
+struct RangeJob
+{
+    std::string input;
+    double      start = 0; // seconds
+    double      end   = 0; // seconds, 0 - up to the end
+    std::string outName;   // empty - name.<start>-<end>.mp3
+    std::string encoder;   // empty - the --encoder one
+    size_t      root  = 0; // index of the list in Options::inputs
+};
+
+struct Options
+{
+    std::vector<std::string> inputs;                    // folders, files and @file_lists to encode
+    size_t                   workerNum         = 0;     // 0 - one worker per CPU core
+    size_t                   minWorkers        = 0;     // bounds of the tuned worker count,
+    size_t                   maxWorkers        = 0;     // 0 - workerNum stays as it is
+    size_t                   processNum        = 0;     // forked worker processes instead of threads, 0 - threads
+    bool                     isScalingBench    = false;
+    bool                     isTranscode       = false; // accept MP3 inputs and re-encode them
+    int32_t                  bitrate           = 0;     // CBR kbps, 0 - lame's default
+    int32_t                  peakSamples       = 0;     // waveform peaks sidecar resolution, 0 - no peaks
+    int32_t                  peakLevels        = 3;
+    bool                     isPeaksJson       = false;
+    bool                     isManifest        = false; // checksums of inputs and outputs
+    double                   maxReadMBps       = 0;     // I/O limits shared by all workers, 0 - no limit
+    double                   maxWriteMBps      = 0;
+    double                   maxIops           = 0;
+    double                   ioBurstMs         = 250;   // how much unused budget may be spent at once
+    bool                     isBackground      = false; // workers at idle CPU and I/O priority
+    size_t                   hostCpus          = 0;     // CPU tokens shared by all processes on the host, 0 - none
+    int32_t                  dualMonoThreshold = -1;    // max |L - R| of a dual mono file, -1 - no check
+    SilenceMode              silenceMode       = SilenceMode::Off;
+    int32_t                  silenceThreshold  = 0;     // max |sample| of a silent file
+    bool                     isAutoSampleRate  = false; // lower MP3 sample rate when the bandwidth allows
+    bool                     isClassify        = false; // choose speechPreset or musicPreset per file
+    Preset                   speechPreset      = { true, 48, 7, 16000 };
+    Preset                   musicPreset;
+    double                   startSeconds      = 0;     // encode only this part of every input
+    double                   endSeconds        = 0;     // 0 - up to the end
+    std::vector<RangeJob>    rangeJobs;                 // lines of all --ranges lists
+    std::vector<size_t>      rangeLists;                // indices of --ranges lists in inputs
+    bool                     isFollow          = false; // WAV inputs may still be being written
+    double                   followTimeout     = 60;    // seconds without growth a recording counts as done
+    double                   hlsSegmentSeconds = 0;     // > 0 - HLS segments and a playlist instead of one MP3
+    int32_t                  seekIndexFrames   = 0;     // seek index sidecar entry every N frames, 0 - none
+    int32_t                  splitNum          = 0;     // encode each file in up to N pieces at once, 0 - one
+    EncoderKind              encoder           = EncoderKind::Lame;
+    bool                     isEncoderBench    = false;
+    std::string              packFile;                  // pack the inputs into this bundle instead of encoding
+};
+
+bool parseEncoder(std::string const& name, EncoderKind& encoder);
+bool parseOptions(int argNum, char** args, Options& options);
+void printUsage();
+
+#endif // OPTIONS_H
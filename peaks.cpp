@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "peaks.hpp"
+
+using std::string;
+using std::vector;
+
+static const constexpr int16_t SHORT_MIN   = std::numeric_limits<int16_t>::min();
+static const constexpr int16_t SHORT_MAX   = std::numeric_limits<int16_t>::max();
+static const constexpr int32_t LEVEL_MERGE = 4; // peaks of a level merged into one of the next level
+
+
+// update per channel min/max with frames of interleaved samples,
+// mono and stereo go through SSE2: 8 samples are 8 or 4 frames
+// and channels sit in fixed lanes, so lanes are folded at the end only
+static void minMax(int16_t const* samples, int32_t frames, int32_t channels, int16_t* mins, int16_t* maxs)
+{
+    int32_t const total = frames * channels;
+    int32_t       idx   = 0;
+
+#if defined (__SSE2__)
+    if (channels <= 2 && total >= 8) {
+        __m128i vMin = _mm_set1_epi16(SHORT_MAX);
+        __m128i vMax = _mm_set1_epi16(SHORT_MIN);
+
+        for (; idx + 8 <= total; idx += 8) {
+            auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(samples + idx));
+            vMin = _mm_min_epi16(vMin, v);
+            vMax = _mm_max_epi16(vMax, v);
+        }
+
+        alignas(16) int16_t laneMin[8];
+        alignas(16) int16_t laneMax[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(laneMin), vMin);
+        _mm_store_si128(reinterpret_cast<__m128i*>(laneMax), vMax);
+
+        for (int32_t lane = 0; lane < 8; ++lane) {
+            auto const ch = lane % channels;
+            mins[ch] = std::min(mins[ch], laneMin[lane]);
+            maxs[ch] = std::max(maxs[ch], laneMax[lane]);
+        }
+    }
+#endif
+
+    for (; idx < total; ++idx) { // tail or no SIMD
+        auto const ch = idx % channels;
+        mins[ch] = std::min(mins[ch], samples[idx]);
+        maxs[ch] = std::max(maxs[ch], samples[idx]);
+    }
+}
+
+
+PeakBuilder::PeakBuilder(int32_t sampleRate, int32_t channels, int32_t samplesPerPeak, int32_t levelNum)
+    : sampleRate(sampleRate)
+    , channels  (channels)
+    , levelNum  (std::max(1, levelNum))
+    , binMin    (channels, SHORT_MAX)
+    , binMax    (channels, SHORT_MIN)
+{
+    peakLevels.push_back({ samplesPerPeak, {} });
+}
+
+
+void PeakBuilder::closePeak()
+{
+    auto& peaks = peakLevels.front().peaks;
+
+    for (int32_t ch = 0; ch < channels; ++ch) {
+        peaks.push_back(binMin[ch]);
+        peaks.push_back(binMax[ch]);
+    }
+
+    std::fill(binMin.begin(), binMin.end(), SHORT_MAX);
+    std::fill(binMax.begin(), binMax.end(), SHORT_MIN);
+    binFill = 0;
+}
+
+
+void PeakBuilder::add(int16_t const* interleaved, int32_t frames)
+{
+    auto const samplesPerPeak = peakLevels.front().samplesPerPeak;
+
+    while (frames > 0) {
+        auto const toTake = std::min(frames, samplesPerPeak - binFill);
+        minMax(interleaved, toTake, channels, binMin.data(), binMax.data());
+
+        interleaved += toTake * channels;
+        frames      -= toTake;
+        binFill     += toTake;
+
+        if (binFill == samplesPerPeak)
+            closePeak();
+    }
+}
+
+
+void PeakBuilder::finish()
+{
+    if (binFill > 0)
+        closePeak();
+
+    auto const stride = channels * 2;
+
+    while (static_cast<int32_t>(peakLevels.size()) < levelNum) {
+        auto const& fine = peakLevels.back();
+        Level coarse = { fine.samplesPerPeak * LEVEL_MERGE, {} };
+
+        for (size_t first = 0; first < fine.peaks.size(); first += stride * LEVEL_MERGE) {
+            auto const last = std::min(fine.peaks.size(), first + stride * LEVEL_MERGE);
+
+            for (int32_t ch = 0; ch < channels; ++ch) {
+                int16_t peakMin = SHORT_MAX;
+                int16_t peakMax = SHORT_MIN;
+
+                for (auto idx = first + ch * 2; idx < last; idx += stride) {
+                    peakMin = std::min(peakMin, fine.peaks[idx]);
+                    peakMax = std::max(peakMax, fine.peaks[idx + 1]);
+                }
+
+                coarse.peaks.push_back(peakMin);
+                coarse.peaks.push_back(peakMax);
+            }
+        }
+
+        peakLevels.push_back(std::move(coarse));
+    }
+}
+
+
+// little endian layout:
+//   "E2PK", u16 version, u16 channels, u32 sample rate, u32 level count,
+//   per level: u32 samples per peak, u32 peak count, s16 [peak][channel][min, max]
+bool PeakBuilder::writeBinary(string const& fileName) const
+{
+#pragma pack(push, 1)
+    struct FileHeader
+    {
+        char     magic[4];
+        uint16_t version;
+        uint16_t channels;
+        uint32_t sampleRate;
+        uint32_t levelNum;
+    };
+#pragma pack (pop)
+
+    std::ofstream out(fileName, std::ios_base::binary | std::ofstream::out);
+    FileHeader const header = { { 'E', '2', 'P', 'K' }, 1, static_cast<uint16_t>(channels),
+                                static_cast<uint32_t>(sampleRate), static_cast<uint32_t>(peakLevels.size()) };
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+    for (auto const& level : peakLevels) {
+        uint32_t const levelHeader[2] = { static_cast<uint32_t>(level.samplesPerPeak),
+                                          static_cast<uint32_t>(level.peaks.size() / (channels * 2)) };
+        out.write(reinterpret_cast<char const*>(levelHeader), sizeof(levelHeader));
+        out.write(reinterpret_cast<char const*>(level.peaks.data()),
+                  static_cast<std::streamsize>(level.peaks.size() * sizeof(int16_t)));
+    }
+
+    return static_cast<bool>(out.flush());
+}
+
+
+bool PeakBuilder::writeJson(string const& fileName) const
+{
+    std::ofstream out(fileName, std::ofstream::out);
+
+    out << "{\"version\":1,\"channels\":" << channels << ",\"sample_rate\":" << sampleRate << ",\"levels\":[";
+
+    for (size_t lvl = 0; lvl < peakLevels.size(); ++lvl) {
+        out << (lvl ? "," : "") << "{\"samples_per_peak\":" << peakLevels[lvl].samplesPerPeak << ",\"data\":[";
+
+        auto const& peaks = peakLevels[lvl].peaks;
+        for (size_t idx = 0; idx < peaks.size(); ++idx)
+            out << (idx ? "," : "") << peaks[idx];
+
+        out << "]}";
+    }
+
+    out << "]}\n";
+    return static_cast<bool>(out.flush());
+}
@@ -0,0 +1,41 @@
+#ifndef PEAKS_H
+#define PEAKS_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// waveform overview for players: min/max of every samplesPerPeak frames per channel,
+// each next level merges 4 peaks of the previous one
+class PeakBuilder
+{
+public:
+    struct Level
+    {
+        int32_t              samplesPerPeak;
+        std::vector<int16_t> peaks; // [peak][channel][min, max]
+    };
+
+    PeakBuilder(int32_t sampleRate, int32_t channels, int32_t samplesPerPeak, int32_t levelNum);
+
+    void add(int16_t const* interleaved, int32_t frames); // as they come from the source
+    void finish();                                         // close the last partial peak, build coarse levels
+
+    bool writeBinary(std::string const& fileName) const;
+    bool writeJson  (std::string const& fileName) const;
+
+    std::vector<Level> const& levels() const { return peakLevels; }
+
+private:
+    void closePeak();
+
+    int32_t              sampleRate;
+    int32_t              channels;
+    int32_t              levelNum;
+    int32_t              binFill = 0; // frames in the current finest peak
+    std::vector<int16_t> binMin;
+    std::vector<int16_t> binMax;
+    std::vector<Level>   peakLevels;
+};
+
+#endif // PEAKS_H
@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <string.h>
+#include <pthread.h> // POSIX
+#include <time.h>
+
+#include "encode2mp3.hpp"
+#include "pool.hpp"
+#include "priority.hpp"
+#include "tuner.hpp"
+
+using std::vector;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+struct Pool
+{
+    JobFunc         func;
+    void*           ctx;
+    size_t          jobNum;
+    bool            isBackground;
+    size_t          nextJob = 0;
+    size_t          running = 0; // jobs taken and not finished yet
+    size_t          activeLimit = std::numeric_limits<size_t>::max(); // workers from this index on wait
+    Worker*         workers     = nullptr; // built in threads
+    pthread_mutex_t jobMtx   = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t  doneCnd  = PTHREAD_COND_INITIALIZER;
+    pthread_cond_t  limitCnd = PTHREAD_COND_INITIALIZER;
+    vector<double>  busySeconds; // per worker on an executor
+};
+
+// worker of a pool run on an executor, may start after runPool() returned
+struct PoolTask
+{
+    std::shared_ptr<Pool> pool;
+    size_t                slot;
+};
+
+Executor* hostExecutor = nullptr;
+std::atomic<uint64_t> progressMicros(0); // addPoolProgress() units / 1e6
+}
+
+
+static double secondsBetween(Clock::time_point from, Clock::time_point to)
+{
+    return std::chrono::duration<double>(to - from).count();
+}
+
+
+// take the next job index or return false if the queue is drained,
+// workers above the active limit wait until it grows or the queue drains
+static bool takeJob(Pool& pool, size_t workerIdx, size_t& jobIdx)
+{
+    ::pthread_mutex_lock(&pool.jobMtx);
+    while (workerIdx >= pool.activeLimit && pool.nextJob < pool.jobNum)
+        ::pthread_cond_wait(&pool.limitCnd, &pool.jobMtx);
+
+    bool const isTaken = pool.nextJob < pool.jobNum;
+    if (isTaken) {
+        jobIdx = pool.nextJob++;
+        ++pool.running;
+        if (pool.nextJob == pool.jobNum) // waiting workers can leave
+            ::pthread_cond_broadcast(&pool.limitCnd);
+    }
+    ::pthread_mutex_unlock(&pool.jobMtx);
+    return isTaken;
+}
+
+
+static void finishJob(Pool& pool)
+{
+    ::pthread_mutex_lock(&pool.jobMtx);
+    if (--pool.running == 0 && pool.nextJob == pool.jobNum)
+        ::pthread_cond_broadcast(&pool.doneCnd);
+    ::pthread_mutex_unlock(&pool.jobMtx);
+}
+
+
+// run jobs until the queue is drained, time spent in them is added
+// before each job counts as finished
+static void runJobs(Pool& pool, size_t workerIdx, double& busySeconds)
+{
+    size_t jobIdx = 0;
+
+    while (takeJob(pool, workerIdx, jobIdx)) {
+        auto const start = Clock::now();
+        pool.func(jobIdx, pool.ctx);
+        busySeconds += secondsBetween(start, Clock::now());
+        finishJob(pool);
+    }
+}
+
+
+static void* poolWorker(void* arg)
+{
+    auto& worker = *static_cast<Worker*>(arg);
+    auto& pool   = *static_cast<Pool*>(worker.pool);
+
+    if (pool.isBackground && !enterBackgroundClass())
+        worker.isPriorityKept = true; // the caller says so once
+
+    runJobs(pool, static_cast<size_t>(&worker - pool.workers), worker.busySeconds);
+    return nullptr;
+}
+
+
+static void poolTask(void* arg)
+{
+    std::unique_ptr<PoolTask> task(static_cast<PoolTask*>(arg));
+    runJobs(*task->pool, task->slot, task->pool->busySeconds[task->slot]); // nothing left to take if it starts late
+}
+
+
+// runPool() on the host's threads: the caller works too, so pools started
+// from inside a job finish even when all host threads are taken; host
+// threads keep their priority, isBackground doesn't apply
+static PoolStats runOnExecutor(Executor& executor, size_t jobNum, size_t workerNum, JobFunc func, void* ctx)
+{
+    auto pool = std::make_shared<Pool>();
+    pool->func   = func;
+    pool->ctx    = ctx;
+    pool->jobNum = jobNum;
+
+    workerNum = std::max<size_t>(1, std::min({ workerNum, jobNum, executor.concurrency() }));
+    pool->busySeconds.assign(workerNum, 0);
+    auto const start = Clock::now();
+
+    for (size_t slot = 1; slot < workerNum; ++slot)
+        executor.submit(&poolTask, new PoolTask{ pool, slot });
+
+    runJobs(*pool, 0, pool->busySeconds[0]);
+
+    PoolStats stats;
+
+    ::pthread_mutex_lock(&pool->jobMtx);
+    while (pool->running > 0)
+        ::pthread_cond_wait(&pool->doneCnd, &pool->jobMtx);
+    stats.busySeconds = pool->busySeconds;
+    ::pthread_mutex_unlock(&pool->jobMtx);
+
+    stats.wallSeconds = secondsBetween(start, Clock::now());
+    return stats;
+}
+
+
+// wait up to seconds for all jobs to finish, true if they did
+static bool waitDone(Pool& pool, double seconds)
+{
+    timespec deadline;
+    ::clock_gettime(CLOCK_REALTIME, &deadline); // pthread_cond_timedwait's default clock
+    auto const nanos = static_cast<int64_t>(deadline.tv_nsec) + static_cast<int64_t>(seconds * 1e9);
+    deadline.tv_sec  += static_cast<time_t>(nanos / 1000000000);
+    deadline.tv_nsec  = static_cast<long>(nanos % 1000000000);
+
+    ::pthread_mutex_lock(&pool.jobMtx);
+    int status = 0;
+    while ((pool.nextJob < pool.jobNum || pool.running > 0) && status == 0)
+        status = ::pthread_cond_timedwait(&pool.doneCnd, &pool.jobMtx, &deadline);
+    bool const isDone = pool.nextJob == pool.jobNum && pool.running == 0;
+    ::pthread_mutex_unlock(&pool.jobMtx);
+    return isDone;
+}
+
+
+// the caller's part of a tuned pool: measure every interval, move the active limit,
+// which starts at startWorkers
+static void tunePool(Pool& pool, PoolTuning const& tuning, size_t startWorkers, size_t maxWorkers)
+{
+    ConcurrencyTuner tuner(tuning.minWorkers, maxWorkers, startWorkers);
+    uint64_t         ioWait   = 0;
+    uint64_t         cpuTotal = 0;
+    auto             progress = progressMicros.load();
+    auto             measured = Clock::now();
+    bool const       isCpu    = sampleCpuTimes(ioWait, cpuTotal);
+
+    while (!waitDone(pool, tuning.intervalSeconds)) {
+        uint64_t   nowIoWait   = 0;
+        uint64_t   nowCpuTotal = 0;
+        auto const now         = Clock::now();
+        auto const nowProgress = progressMicros.load();
+        auto const rate        = (nowProgress - progress) / 1e6 / secondsBetween(measured, now);
+        auto const ioShare     = isCpu && sampleCpuTimes(nowIoWait, nowCpuTotal) && nowCpuTotal > cpuTotal
+                               ? static_cast<double>(nowIoWait - ioWait) / (nowCpuTotal - cpuTotal) : 0.0;
+        auto const from        = tuner.workers();
+        auto const to          = tuner.next(rate, ioShare);
+
+        progress = nowProgress;
+        measured = now;
+        ioWait   = nowIoWait;
+        cpuTotal = nowCpuTotal;
+
+        if (from != to) {
+            ::pthread_mutex_lock(&pool.jobMtx);
+            pool.activeLimit = to;
+            ::pthread_cond_broadcast(&pool.limitCnd);
+            ::pthread_mutex_unlock(&pool.jobMtx);
+        }
+
+        if (tuning.log && ::strcmp(tuner.reason(), "hold") != 0) // quiet while nothing happens
+            tuning.log(from, to, rate, ioShare, tuner.reason());
+    }
+}
+
+
+// number of workers to use when user didn't ask for a specific one
+size_t defaultWorkerNum()
+{
+    if (hostExecutor)
+        return std::max<size_t>(1, hostExecutor->concurrency());
+
+    auto const cores = std::thread::hardware_concurrency();
+    return cores > 0 ? cores : 1;
+}
+
+
+// run jobs in index order on workerNum threads, the calling thread only waits
+// or tunes the number of them, background workers run at idle CPU and I/O
+// priority, the caller keeps its own
+PoolStats runPool(size_t jobNum, size_t workerNum, JobFunc func, void* ctx, bool isBackground, PoolTuning const* tuning)
+{
+    if (hostExecutor)
+        return runOnExecutor(*hostExecutor, jobNum, workerNum, func, ctx);
+
+    Pool pool;
+    pool.func         = func;
+    pool.ctx          = ctx;
+    pool.jobNum       = jobNum;
+    pool.isBackground = isBackground;
+
+    bool const isTuned    = tuning && tuning->maxWorkers > 0;
+    auto const threadNum  = std::max<size_t>(1, std::min(isTuned ? tuning->maxWorkers : workerNum, jobNum));
+    vector<Worker> workers(threadNum); // all of them start, tuning only lets some wait
+    pool.workers = workers.data();
+
+    if (isTuned)
+        pool.activeLimit = ConcurrencyTuner(tuning->minWorkers, threadNum, workerNum).workers();
+
+    auto const start = Clock::now();
+
+    for (auto& worker : workers) {
+        worker.pool = &pool;
+
+        if (::pthread_create(&worker.thread, nullptr, &poolWorker, &worker) != 0)
+            throw std::runtime_error("pthread_create() failed");
+    }
+
+    if (isTuned)
+        tunePool(pool, *tuning, pool.activeLimit, threadNum);
+
+    PoolStats stats;
+
+    for (auto& worker : workers) {
+        ::pthread_join(worker.thread, &worker.pStatus);
+        stats.busySeconds.push_back(worker.busySeconds);
+        stats.isPriorityKept = stats.isPriorityKept || worker.isPriorityKept;
+    }
+
+    stats.wallSeconds = secondsBetween(start, Clock::now());
+    return stats;
+}
+
+
+void setExecutor(Executor* executor)
+{
+    hostExecutor = executor;
+}
+
+
+Executor* getExecutor()
+{
+    return hostExecutor;
+}
+
+
+void addPoolProgress(double units)
+{
+    progressMicros += static_cast<uint64_t>(units * 1e6);
+}
@@ -0,0 +1,58 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <vector>
+
+// job callback, called once for each job index in [0, jobNum)
+using JobFunc = void (*)(size_t jobIdx, void* ctx);
+
+using TaskFunc = void (*)(void* arg);
+
+// thread pool of an application embedding the encoder; when one is set, runPool()
+// submits its workers there instead of starting threads of its own
+class Executor
+{
+public:
+    virtual ~Executor() = default;
+
+    // run func(arg) once on one of the pool's threads, must not run it inline
+    virtual void submit(TaskFunc func, void* arg) = 0;
+
+    // number of threads the encoder may keep busy at once, a hint
+    virtual size_t concurrency() const = 0;
+};
+
+// called for every change of the number of active workers
+using TuneLogFunc = void (*)(size_t fromWorkers, size_t toWorkers, double rate, double ioWait, char const* reason);
+
+// runtime tuning of the active worker count on the throughput reported with
+// addPoolProgress(), see ConcurrencyTuner; built in threads only, the host
+// of an executor manages its own concurrency
+struct PoolTuning
+{
+    size_t      minWorkers      = 1;
+    size_t      maxWorkers      = 0; // 0 - no tuning
+    double      intervalSeconds = 2;
+    TuneLogFunc log             = nullptr;
+};
+
+struct PoolStats
+{
+    double              wallSeconds    = 0;
+    std::vector<double> busySeconds; // one per worker, time spent inside JobFunc
+    bool                isPriorityKept = false; // isBackground and a worker couldn't lower its priority
+};
+
+size_t    defaultWorkerNum();
+PoolStats runPool(size_t jobNum, size_t workerNum, JobFunc func, void* ctx, bool isBackground = false,
+                  PoolTuning const* tuning = nullptr); // workerNum is where tuning starts
+
+// work done by a job so far, e.g. audio seconds encoded, from any thread
+void      addPoolProgress(double units);
+
+// nullptr - built in threads, the default; set before the first runPool()
+void      setExecutor(Executor* executor);
+Executor* getExecutor();
+
+#endif // POOL_H
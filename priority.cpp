@@ -0,0 +1,40 @@
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+#include "priority.hpp"
+
+
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+// see linux/ioprio.h, not shipped by every libc
+static const constexpr int IOPRIO_CLASS_IDLE   = 3;
+static const constexpr int IOPRIO_CLASS_SHIFT  = 13;
+static const constexpr int IOPRIO_WHO_PROCESS  = 1;
+
+// on Linux scheduling policy, nice value and I/O priority all belong to
+// a thread, so only workers calling this are affected, not main thread
+bool enterBackgroundClass()
+{
+    auto const tid = static_cast<id_t>(::syscall(SYS_gettid));
+    sched_param param = {};
+    param.sched_priority = 0;
+
+    bool const isIdle = ::pthread_setschedparam(::pthread_self(), SCHED_IDLE, &param) == 0;
+    bool const isNice = ::setpriority(PRIO_PROCESS, tid, 19) == 0; // still matters if SCHED_IDLE was refused
+    bool const isIo   = ::syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) == 0;
+
+    return isIdle || isNice || isIo;
+}
+#else
+// background mode lowers both CPU and I/O priority of the thread
+bool enterBackgroundClass()
+{
+    return ::SetThreadPriority(::GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN) != 0;
+}
+#endif
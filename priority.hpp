@@ -0,0 +1,8 @@
+#ifndef PRIORITY_H
+#define PRIORITY_H
+
+// move the calling thread to the lowest CPU and disk priority so it only
+// gets what everybody else leaves, false if nothing could be changed
+bool enterBackgroundClass();
+
+#endif // PRIORITY_H
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <errno.h>
+#include <string.h>
+
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "priority.hpp"
+#include "procpool.hpp"
+
+using std::string;
+using std::vector;
+using Clock = std::chrono::steady_clock;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "queue counters must be lock free to be shared between processes");
+
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+
+namespace
+{
+// shared memory of a process pool: the queue cursor, a slot per worker,
+// a state per job and then the results of all jobs
+struct SharedQueue
+{
+    std::atomic<uint64_t> nextJob; // where workers look for a queued job first, jobs are taken in order
+};
+
+struct SharedWorker
+{
+    std::atomic<uint64_t> busyMicros;
+    std::atomic<uint32_t> isPriorityKept; // the parent says so once
+};
+
+// a job is claimed by one compare and swap of its state from Queued to Running
+// plus the worker slot, so whenever a worker dies its job is known
+enum JobState : uint32_t { Queued, Done, Failed, Running };
+
+struct ProcessPool
+{
+    size_t                 jobNum;
+    size_t                 resultSize;
+    ProcessJobFunc         func;
+    void*                  ctx;
+    bool                   isBackground;
+    size_t                 mapSize = 0;
+    SharedQueue*           queue   = nullptr;
+    SharedWorker*          workers = nullptr;
+    std::atomic<uint32_t>* states  = nullptr;
+    uint8_t*               results = nullptr;
+};
+}
+
+
+static size_t alignUp(size_t size)
+{
+    return (size + 63) / 64 * 64; // each part on cache lines of its own
+}
+
+
+static void runWorker(ProcessPool& pool, size_t slot)
+{
+    auto& worker = pool.workers[slot];
+
+    if (pool.isBackground && !enterBackgroundClass())
+        worker.isPriorityKept = 1;
+
+    for (auto jobIdx = pool.queue->nextJob.load(); jobIdx < pool.jobNum; jobIdx = pool.queue->nextJob.load()) {
+        uint32_t   state   = Queued;
+        bool const isTaken = pool.states[jobIdx].compare_exchange_strong(state, Running + static_cast<uint32_t>(slot));
+
+        pool.queue->nextJob.compare_exchange_strong(jobIdx, jobIdx + 1); // taken by us or another worker either way
+        if (!isTaken)
+            continue;
+
+        auto const start = Clock::now();
+
+        pool.func(static_cast<size_t>(jobIdx), pool.results + jobIdx * pool.resultSize, pool.ctx);
+
+        worker.busyMicros += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+        pool.states[jobIdx].store(Done, std::memory_order_release); // after the result
+    }
+}
+
+
+static pid_t startWorker(ProcessPool& pool, size_t slot)
+{
+    std::cout.flush(); // buffered output would be written by both
+    std::cerr.flush();
+
+    auto const pid = ::fork();
+
+    if (pid == 0) {
+        runWorker(pool, slot);
+        std::cout.flush();
+        std::cerr.flush();
+        ::_exit(0); // no atexit handlers and static destructors of the parent's state
+    }
+
+    return pid;
+}
+
+
+bool runProcessPool(size_t jobNum, size_t processNum, size_t resultSize, ProcessJobFunc func, ProcessCrashFunc crashFunc,
+                    void* ctx, bool isBackground, vector<uint8_t>& results, vector<uint8_t>& isDone,
+                    ProcessStats& stats, string& error)
+{
+    ProcessPool pool       = { jobNum, resultSize, func, ctx, isBackground };
+    auto const  start      = Clock::now();
+    auto const  workersPos = alignUp(sizeof(SharedQueue));
+    auto const  statesPos  = workersPos + alignUp(processNum * sizeof(SharedWorker));
+    auto const  resultsPos = statesPos + alignUp(jobNum * sizeof(std::atomic<uint32_t>));
+
+    pool.mapSize = std::max<size_t>(resultsPos + jobNum * resultSize, 1);
+    void* addr   = ::mmap(nullptr, pool.mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0); // zero filled
+
+    if (addr == MAP_FAILED) {
+        error = string("mmap failed: ") + ::strerror(errno);
+        return false;
+    }
+
+    auto const base = static_cast<uint8_t*>(addr);
+    pool.queue   = new (base) SharedQueue();
+    pool.workers = reinterpret_cast<SharedWorker*>(base + workersPos);
+    pool.states  = reinterpret_cast<std::atomic<uint32_t>*>(base + statesPos);
+    pool.results = base + resultsPos;
+
+    for (size_t slot = 0; slot < processNum; ++slot)
+        new (&pool.workers[slot]) SharedWorker();
+    for (size_t jobIdx = 0; jobIdx < jobNum; ++jobIdx)
+        new (&pool.states[jobIdx]) std::atomic<uint32_t>(Queued);
+
+    auto   pids  = vector<pid_t>(processNum, -1);
+    size_t alive = 0;
+
+    for (size_t slot = 0; slot < processNum; ++slot) {
+        pids[slot] = startWorker(pool, slot);
+        alive     += pids[slot] > 0 ? 1 : 0;
+    }
+
+    if (alive == 0) {
+        error = string("fork failed: ") + ::strerror(errno);
+        ::munmap(addr, pool.mapSize);
+        return false;
+    }
+
+    while (alive > 0) {
+        int        status = 0;
+        auto const pid    = ::waitpid(-1, &status, 0);
+
+        if (pid < 0 && errno == EINTR)
+            continue;
+        if (pid < 0)
+            break;
+
+        auto const slot = static_cast<size_t>(std::find(pids.begin(), pids.end(), pid) - pids.begin());
+        if (slot == pids.size()) // not one of ours
+            continue;
+
+        --alive;
+        pids[slot] = -1;
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+            continue;
+
+        for (size_t jobIdx = 0; jobIdx < jobNum; ++jobIdx) { // the one it was running, if any
+            uint32_t running = Running + static_cast<uint32_t>(slot);
+
+            if (pool.states[jobIdx].compare_exchange_strong(running, Failed)) {
+                stats.crashedJobs.push_back(jobIdx);
+                if (crashFunc)
+                    crashFunc(jobIdx, ctx);
+                break;
+            }
+        }
+
+        if (pool.queue->nextJob.load() < jobNum) { // a replacement for the rest of the queue
+            pids[slot] = startWorker(pool, slot);
+            alive     += pids[slot] > 0 ? 1 : 0;
+            stats.respawns++;
+        }
+    }
+
+    results.assign(pool.results, pool.results + jobNum * resultSize);
+    isDone.resize(jobNum);
+    for (size_t jobIdx = 0; jobIdx < jobNum; ++jobIdx)
+        isDone[jobIdx] = pool.states[jobIdx].load(std::memory_order_acquire) == Done ? 1 : 0;
+
+    stats.busySeconds.resize(processNum);
+    for (size_t slot = 0; slot < processNum; ++slot) {
+        stats.busySeconds[slot] = pool.workers[slot].busyMicros / 1e6;
+        stats.isPriorityKept    = stats.isPriorityKept || pool.workers[slot].isPriorityKept != 0;
+    }
+
+    stats.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    ::munmap(addr, pool.mapSize);
+    return true;
+}
+
+
+bool isProcessPoolSupported()
+{
+    return true;
+}
+
+#else // no fork() and anonymous shared mappings, --processes is refused
+
+bool runProcessPool(size_t, size_t, size_t, ProcessJobFunc, ProcessCrashFunc, void*, bool, vector<uint8_t>&, vector<uint8_t>&,
+                    ProcessStats&, string& error)
+{
+    error = "worker processes need Linux";
+    return false;
+}
+
+
+bool isProcessPoolSupported()
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef PROCPOOL_H
+#define PROCPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// job callback of a worker process, fills resultSize bytes of a trivially
+// copyable result for the parent
+using ProcessJobFunc = void (*)(size_t jobIdx, void* result, void* ctx);
+
+// called in the parent for a job whose worker died, e.g. to remove what it left
+// half written, before a replacement worker is started
+using ProcessCrashFunc = void (*)(size_t jobIdx, void* ctx);
+
+struct ProcessStats
+{
+    double              wallSeconds    = 0;
+    std::vector<double> busySeconds; // one per worker slot, a respawned worker adds to its slot
+    std::vector<size_t> crashedJobs; // jobs a worker died on
+    size_t              respawns       = 0;
+    bool                isPriorityKept = false; // isBackground and a worker couldn't lower its priority
+};
+
+// runPool() on processNum forked worker processes instead of threads: the jobs
+// are taken from a queue in shared memory and every worker writes the result of
+// its job there. A worker dying (signal or non-zero exit) fails only the job it
+// was on, the parent marks it, calls crashFunc (may be null) and starts another
+// worker in its place. isDone is
+// 0 for jobs without a result. Call before any thread is started, fork() copies
+// only the calling thread; false with error set if the queue can't be set up
+bool runProcessPool(size_t jobNum, size_t processNum, size_t resultSize, ProcessJobFunc func, ProcessCrashFunc crashFunc,
+                    void* ctx, bool isBackground, std::vector<uint8_t>& results, std::vector<uint8_t>& isDone,
+                    ProcessStats& stats, std::string& error);
+bool isProcessPoolSupported(); // Linux only
+
+#endif // PROCPOOL_H
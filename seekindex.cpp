@@ -0,0 +1,59 @@
+#include <fstream>
+
+#include "seekindex.hpp"
+
+using std::string;
+
+
+SeekIndexBuilder::SeekIndexBuilder(int32_t framesPerEntry)
+    : framesPerEntry(framesPerEntry)
+{
+}
+
+
+void SeekIndexBuilder::add(uint8_t const* data, size_t size)
+{
+    uint8_t const* frame = nullptr;
+    Mp3FrameInfo   info;
+
+    splitter.add(data, size);
+
+    while (splitter.next(frame, info)) {
+        bool const isFirst = !isStarted;
+        isStarted = true;
+
+        if (isFirst && (isTagFirst ? isTagPlaceholderFrame(frame, static_cast<size_t>(info.size), info) : isInfoTagFrame(frame, info)))
+            continue; // no audio, seeking starts after it
+
+        if (frameNum % framesPerEntry == 0)
+            list.push_back({ splitter.offsetOf(frame), samples });
+
+        sampleRate = info.sampleRate;
+        samples   += static_cast<uint64_t>(info.samples);
+        ++frameNum;
+    }
+}
+
+
+bool SeekIndexBuilder::write(string const& fileName) const
+{
+#pragma pack(push, 1)
+    struct FileHeader
+    {
+        char     magic[4];
+        uint16_t version;
+        uint16_t reserved;
+        uint32_t sampleRate;
+        uint32_t framesPerEntry;
+        uint32_t entryNum;
+    };
+#pragma pack (pop)
+
+    std::ofstream out(fileName, std::ios_base::binary | std::ofstream::out);
+    FileHeader const header = { { 'E', '2', 'S', 'K' }, 1, 0, static_cast<uint32_t>(sampleRate),
+                                static_cast<uint32_t>(framesPerEntry), static_cast<uint32_t>(list.size()) };
+    out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    out.write(reinterpret_cast<char const*>(list.data()), static_cast<std::streamsize>(list.size() * sizeof(Entry)));
+
+    return static_cast<bool>(out.flush());
+}
@@ -0,0 +1,48 @@
+#ifndef SEEKINDEX_H
+#define SEEKINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "mp3frame.hpp"
+
+// byte offset and sample position of every Nth frame of an MP3 stream,
+// collected from the data as the encoder returns it
+class SeekIndexBuilder
+{
+public:
+    struct Entry
+    {
+        uint64_t offset;  // of the frame header in the MP3
+        uint64_t samples; // per channel decoded before the frame
+    };
+
+    explicit SeekIndexBuilder(int32_t framesPerEntry);
+
+    // the stream starts with the encoder's tag placeholder, a header and zeros until
+    // the tag goes over it, which is indistinguishable from a silent frame otherwise;
+    // before the first add()
+    void setTagFirst(bool isTagFirst) { this->isTagFirst = isTagFirst; }
+
+    void add(uint8_t const* data, size_t size);
+
+    // "E2SK", u16 version (1), u16 zero, u32 sample rate, u32 frames per entry,
+    // u32 entry count, then u64 offset and u64 samples per entry, little endian
+    bool write(std::string const& fileName) const;
+
+    std::vector<Entry> const& entries() const { return list; }
+
+private:
+    Mp3FrameSplitter   splitter;
+    int32_t            framesPerEntry;
+    int32_t            sampleRate = 0;
+    bool               isTagFirst = false;
+    bool               isStarted  = false; // past the first frame, the only one that may be the tag
+    uint64_t           frameNum   = 0; // audio frames seen
+    uint64_t           samples    = 0;
+    std::vector<Entry> list;
+};
+
+#endif // SEEKINDEX_H
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "shmring.hpp"
+
+using std::string;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "ring indices must be lock free to be shared between processes");
+
+static const constexpr char     SHM_PREFIX[]  = "shm:";
+static const constexpr uint32_t RING_VERSION  = 1;
+static const constexpr size_t   DATA_ALIGN    = 64; // ring data on its own cache line
+static const constexpr auto     WAIT_STEP     = std::chrono::microseconds(500);
+static const constexpr int      PID_CHECK_GAP = 2000; // waits between liveness checks of the producer
+
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+
+ShmRing::~ShmRing()
+{
+    if (header)
+        ::munmap(header, mapSize);
+
+    if (shmFd >= 0)
+        ::close(shmFd);
+
+    if (!shmName.empty())
+        ::shm_unlink(shmName.c_str());
+}
+
+
+bool ShmRing::map(size_t size, string& error)
+{
+    void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+
+    if (addr == MAP_FAILED) {
+        error = string("mmap failed: ") + ::strerror(errno);
+        return false;
+    }
+
+    mapSize = size;
+    header  = static_cast<ShmRingHeader*>(addr);
+    return true;
+}
+
+
+bool ShmRing::create(string const& name, int32_t sampleRate, int32_t channels, size_t capacityFrames, string& error)
+{
+    shmFd = name.empty() ? ::memfd_create("encode2mp3-ring", 0) : ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+    if (shmFd < 0) {
+        error = string("can't create shared memory: ") + ::strerror(errno);
+        return false;
+    }
+
+    shmName   = name;
+    frameSize = static_cast<uint32_t>(channels * sizeof(int16_t));
+
+    auto const dataOffset = (sizeof(ShmRingHeader) + DATA_ALIGN - 1) / DATA_ALIGN * DATA_ALIGN;
+    auto const capacity   = capacityFrames * frameSize;
+
+    if (::ftruncate(shmFd, static_cast<off_t>(dataOffset + capacity)) != 0) {
+        error = string("can't size shared memory: ") + ::strerror(errno);
+        return false;
+    }
+
+    if (!map(dataOffset + capacity, error))
+        return false;
+
+    header->version       = RING_VERSION;
+    header->sampleRate    = sampleRate;
+    header->channels      = static_cast<uint16_t>(channels);
+    header->bitsPerSample = 16;
+    header->dataOffset    = dataOffset;
+    header->capacity      = capacity;
+    header->producerPid   = ::getpid();
+    header->writePos.store(0);
+    header->readPos.store(0);
+    header->isClosed.store(0);
+    data = reinterpret_cast<uint8_t*>(header) + dataOffset;
+    std::atomic_thread_fence(std::memory_order_release);
+    ::memcpy(header->magic, "E2SR", 4); // consumer may attach from now on
+    return true;
+}
+
+
+bool ShmRing::write(int16_t const* frames, int32_t frameNum)
+{
+    auto src  = reinterpret_cast<uint8_t const*>(frames);
+    auto left = static_cast<uint64_t>(frameNum) * frameSize;
+
+    while (left > 0) {
+        auto const writePos = header->writePos.load(std::memory_order_relaxed);
+        auto const free     = header->capacity - (writePos - header->readPos.load(std::memory_order_acquire));
+
+        if (free == 0) {
+            std::this_thread::sleep_for(WAIT_STEP);
+            continue;
+        }
+
+        auto const offset = writePos % header->capacity;
+        auto const toCopy = std::min({ left, free, header->capacity - offset });
+        ::memcpy(data + offset, src, toCopy);
+        header->writePos.store(writePos + toCopy, std::memory_order_release);
+        src  += toCopy;
+        left -= toCopy;
+    }
+
+    return true;
+}
+
+
+void ShmRing::close()
+{
+    header->isClosed.store(1, std::memory_order_release);
+}
+
+
+bool ShmRing::open(string const& name, string& error)
+{
+    shmFd = name[0] == '#' ? ::dup(::atoi(name.c_str() + 1)) : ::shm_open(name.c_str(), O_RDWR, 0);
+    struct stat s;
+
+    if (shmFd < 0 || ::fstat(shmFd, &s) != 0) {
+        error = string("can't open shared memory: ") + ::strerror(errno);
+        return false;
+    }
+
+    if (static_cast<size_t>(s.st_size) < sizeof(ShmRingHeader)) {
+        error = "shared memory is too small";
+        return false;
+    }
+
+    if (!map(static_cast<size_t>(s.st_size), error))
+        return false;
+
+    frameSize = header->channels * sizeof(int16_t); // channels checked below, the ring divides by both
+
+    if (::memcmp(header->magic, "E2SR", 4) != 0 || header->version != RING_VERSION || header->bitsPerSample != 16
+        || header->channels == 0 || header->sampleRate <= 0 || header->dataOffset > mapSize
+        || header->capacity > mapSize - header->dataOffset || header->capacity == 0 || header->capacity % frameSize != 0) {
+        error = "not an encode2mp3 PCM ring";
+        return false;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    data      = reinterpret_cast<uint8_t*>(header) + header->dataOffset;
+    return true;
+}
+
+
+int32_t ShmRing::acquire(int16_t const*& frames, int32_t maxFrames)
+{
+    auto const readPos = header->readPos.load(std::memory_order_relaxed);
+
+    for (int waits = 1; ; ++waits) {
+        bool const isClosed = header->isClosed.load(std::memory_order_acquire) != 0;
+        auto const filled   = header->writePos.load(std::memory_order_acquire) - readPos;
+
+        if (filled >= frameSize) {
+            auto const offset = readPos % header->capacity;
+            auto const bytes  = std::min({ filled, header->capacity - offset, static_cast<uint64_t>(maxFrames) * frameSize });
+            frames = reinterpret_cast<int16_t const*>(data + offset);
+            return static_cast<int32_t>(bytes / frameSize);
+        }
+
+        if (isClosed)
+            return 0;
+
+        if (waits % PID_CHECK_GAP == 0 && ::kill(header->producerPid, 0) != 0 && errno == ESRCH)
+            return 0; // producer died, encode what we have
+
+        std::this_thread::sleep_for(WAIT_STEP);
+    }
+}
+
+
+void ShmRing::release(int32_t frames)
+{
+    auto const readPos = header->readPos.load(std::memory_order_relaxed);
+    header->readPos.store(readPos + static_cast<uint64_t>(frames) * frameSize, std::memory_order_release);
+}
+
+
+bool isShmRingSupported()
+{
+    return true;
+}
+
+#else // no memfd_create(), shm: inputs are refused
+
+ShmRing::~ShmRing() {}
+
+
+bool ShmRing::create(string const&, int32_t, int32_t, size_t, string& error)
+{
+    error = "shared memory rings need Linux";
+    return false;
+}
+
+
+bool ShmRing::write(int16_t const*, int32_t)
+{
+    return false;
+}
+
+
+void ShmRing::close() {}
+
+
+bool ShmRing::open(string const&, string& error)
+{
+    error = "shared memory rings need Linux";
+    return false;
+}
+
+
+int32_t ShmRing::acquire(int16_t const*&, int32_t)
+{
+    return 0;
+}
+
+
+void ShmRing::release(int32_t) {}
+
+
+bool isShmRingSupported()
+{
+    return false;
+}
+
+#endif
+
+
+bool isShmInput(string const& input)
+{
+    return input.compare(0, sizeof(SHM_PREFIX) - 1, SHM_PREFIX) == 0;
+}
+
+
+void parseShmInput(string const& input, string& shmName, string& outFileName)
+{
+    auto const spec   = input.substr(sizeof(SHM_PREFIX) - 1);
+    auto const eqPos  = spec.find('=');
+    shmName           = spec.substr(0, eqPos);
+
+    if (eqPos != string::npos) {
+        outFileName = spec.substr(eqPos + 1);
+        return;
+    }
+
+    auto base = shmName.substr(1); // drop '/' or '#'
+    std::replace(base.begin(), base.end(), '/', '_');
+    outFileName = (shmName[0] == '#' ? "shm-fd" : "") + base + ".mp3";
+}
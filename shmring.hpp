@@ -0,0 +1,68 @@
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <sys/types.h>
+
+// single producer / single consumer ring of interleaved 16 bit PCM in a POSIX
+// shared memory object, the consumer encodes straight from the mapping;
+// the header is followed by the ring data at dataOffset
+struct ShmRingHeader
+{
+    char                  magic[4];      // "E2SR"
+    uint32_t              version;
+    int32_t               sampleRate;
+    uint16_t              channels;
+    uint16_t              bitsPerSample; // 16 only
+    uint64_t              dataOffset;
+    uint64_t              capacity;      // bytes, whole frames
+    pid_t                 producerPid;   // consumer gives up if it dies without closing
+    std::atomic<uint64_t> writePos;      // bytes produced since start, producer only
+    std::atomic<uint64_t> readPos;       // bytes consumed since start, consumer only
+    std::atomic<uint32_t> isClosed;      // no data after writePos will come
+};
+
+class ShmRing
+{
+public:
+    ShmRing() = default;
+    ~ShmRing();
+
+    ShmRing(ShmRing const&) = delete;
+    ShmRing& operator=(ShmRing const&) = delete;
+
+    // producer side: create "/name" holding capacityFrames frames, or
+    // an anonymous memfd if name is empty (pass fd() to the consumer)
+    bool create(std::string const& name, int32_t sampleRate, int32_t channels, size_t capacityFrames, std::string& error);
+    bool write(int16_t const* frames, int32_t frameNum); // blocks while the ring is full
+    void close();                                        // end of stream
+
+    // consumer side: "/name" or "#fd" of an inherited descriptor
+    bool    open(std::string const& name, std::string& error);
+    int32_t acquire(int16_t const*& data, int32_t maxFrames); // waits for data, 0 at end of stream
+    void    release(int32_t frames);                          // frames from acquire are consumed
+
+    int32_t sampleRate() const { return header->sampleRate; }
+    int32_t channels()   const { return header->channels; }
+    int     fd()         const { return shmFd; }
+
+private:
+    bool map(size_t size, std::string& error);
+
+    int            shmFd     = -1;
+    size_t         mapSize   = 0;
+    ShmRingHeader* header    = nullptr;
+    uint8_t*       data      = nullptr;
+    uint32_t       frameSize = 0;
+    std::string    shmName;            // unlinked by the producer on destruction
+};
+
+// "shm:/name" or "shm:#fd", optionally followed by "=output.mp3"
+bool isShmInput(std::string const& input);
+bool isShmRingSupported(); // Linux only
+void parseShmInput(std::string const& input, std::string& shmName, std::string& outFileName);
+
+#endif // SHMRING_H
@@ -0,0 +1,579 @@
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <string.h>
+
+#include <lame/lame.h>
+
+#include "bundle.hpp"
+#include "decompress.hpp"
+#include "encode2mp3.hpp"
+#include "shmring.hpp"
+#include "source.hpp"
+#include "throttle.hpp"
+#include "watch.hpp"
+
+using std::string;
+using std::vector;
+
+namespace
+{
+// canonical 44 bytes header WAV file
+class WavSource : public PcmSource
+{
+public:
+    WavSource(std::ifstream&& file, PcmHeader const& header)
+        : file      (std::move(file))
+        , blockAlign(header.blockAlign)
+    {
+        sampleRate = header.sampleRate;
+        channels   = header.numChannels;
+        frames     = header.subchunk2Size / header.blockAlign;
+    }
+
+    int32_t read(int16_t* buffer, int32_t maxFrames) override
+    {
+        auto const toRead = std::min<int64_t>(maxFrames, frames - framesRead);
+
+        if (toRead <= 0)
+            return 0;
+
+        throttleRead(static_cast<size_t>(toRead * blockAlign));
+        file.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(toRead * blockAlign));
+        auto const framesGot = static_cast<int32_t>(file.gcount() / blockAlign); // truncated file ends early
+        framesRead += framesGot;
+        return framesGot;
+    }
+
+    bool seek(int64_t frame) override
+    {
+        framesRead = std::min(std::max<int64_t>(frame, 0), frames);
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(sizeof(PcmHeader) + framesRead * blockAlign));
+        return static_cast<bool>(file);
+    }
+
+private:
+    std::ifstream file;
+    int64_t       framesRead = 0;
+    uint16_t      blockAlign;
+};
+
+
+// WAV file inside a gzip or zstd one, decompressed on a thread of its own while
+// it's read; a stream, so it can't seek
+class CompressedWavSource : public PcmSource
+{
+public:
+    CompressedWavSource(std::unique_ptr<DecompressStream> stream, PcmHeader const& header)
+        : stream    (std::move(stream))
+        , blockAlign(header.blockAlign)
+    {
+        sampleRate = header.sampleRate;
+        channels   = header.numChannels;
+        frames     = header.subchunk2Size / header.blockAlign;
+    }
+
+    int32_t read(int16_t* buffer, int32_t maxFrames) override
+    {
+        auto const toRead = std::min<int64_t>(maxFrames, frames - framesRead);
+
+        if (toRead <= 0)
+            return 0;
+
+        auto const framesGot = static_cast<int32_t>(stream->read(buffer, static_cast<size_t>(toRead * blockAlign)) / blockAlign); // corrupt or short stream ends early
+        framesRead += framesGot;
+        return framesGot;
+    }
+
+private:
+    std::unique_ptr<DecompressStream> stream;
+    int64_t                           framesRead = 0;
+    uint16_t                          blockAlign;
+};
+
+
+// WAV file another process is still recording: read as it grows, ends once the writer
+// has closed it with the data size filled in or when it stops growing for timeout seconds
+class FollowSource : public PcmSource
+{
+public:
+    FollowSource(std::ifstream&& file, PcmHeader const& header, string const& fileName, double timeout)
+        : file(std::move(file))
+        , blockAlign(header.blockAlign)
+        , timeout(timeout)
+    {
+        sampleRate = header.sampleRate;
+        channels   = header.numChannels;
+        watch.open(fileName);
+        isClosed   = isFinal(header.subchunk2Size); // done before we came
+
+        if (isClosed) // chunks after the data aren't audio, as for WavSource
+            frames = header.subchunk2Size / blockAlign;
+    }
+
+    int32_t read(int16_t* buffer, int32_t maxFrames) override
+    {
+        const constexpr double WAIT_STEP = 0.25; // seconds, how late new data may be picked up without inotify
+
+        for (double idle = 0;;) {
+            auto const toRead = frames >= 0 ? std::min<int64_t>(maxFrames, frames - framesRead) : maxFrames;
+
+            if (toRead <= 0)
+                return 0;
+
+            throttleRead(static_cast<size_t>(toRead * blockAlign));
+            file.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(toRead * blockAlign));
+            auto const bytesGot  = file.gcount();
+            auto const framesGot = static_cast<int32_t>(bytesGot / blockAlign);
+
+            if (!file) { // at the writer's end, a half written frame is read again later
+                file.clear();
+                file.seekg(-static_cast<std::streamoff>(bytesGot % blockAlign), std::ios_base::cur);
+            }
+
+            if (framesGot > 0) {
+                framesRead += framesGot;
+                return framesGot;
+            }
+
+            if (frames >= 0) // less data than the final header says
+                return 0;
+
+            auto const dataSize = readDataSize();
+
+            if ((isClosed || !watch.canSeeClose()) && isFinal(dataSize)) {
+                frames = dataSize / blockAlign;
+                continue;
+            }
+
+            if (idle >= timeout) { // writer is gone without fixing the header
+                frames = framesRead;
+                return 0;
+            }
+
+            auto const event = watch.wait(WAIT_STEP);
+            isClosed = isClosed || event == FileWatch::Event::Closed;
+            idle     = event == FileWatch::Event::Timeout ? idle + WAIT_STEP : 0;
+        }
+    }
+
+private:
+    // recorders write 0 or 0xFFFFFFFF until they're done
+    bool isFinal(uint32_t dataSize) const
+    {
+        return dataSize > 0 && dataSize != 0xFFFFFFFF && dataSize % blockAlign == 0;
+    }
+
+    uint32_t readDataSize()
+    {
+        uint32_t   dataSize = 0;
+        auto const position = file.tellg();
+
+        file.seekg(offsetof(PcmHeader, subchunk2Size));
+        file.read(reinterpret_cast<char*>(&dataSize), sizeof(dataSize));
+        file.clear();
+        file.seekg(position);
+        return dataSize;
+    }
+
+    std::ifstream file;
+    FileWatch     watch;
+    int64_t       framesRead = 0;
+    uint16_t      blockAlign;
+    double        timeout;
+    bool          isClosed   = false;
+};
+
+
+// MP3 file decoded with lame's hip decoder frame by frame
+class Mp3Source : public PcmSource
+{
+public:
+    explicit Mp3Source(std::ifstream&& file)
+        : file(std::move(file))
+        , hip (::hip_decode_init())
+    {}
+
+    ~Mp3Source() override
+    {
+        if (hip)
+            ::hip_decode_exit(hip);
+    }
+
+    // decode the first frame to learn the stream format
+    bool open()
+    {
+        if (!hip || !decodeFrame() || !mp3data.header_parsed)
+            return false;
+
+        sampleRate = mp3data.samplerate;
+        channels   = mp3data.stereo;
+        frames     = mp3data.nsamp > 0 ? static_cast<int64_t>(mp3data.nsamp) : -1; // known from Xing header only
+        return channels == 1 || channels == 2;
+    }
+
+    int32_t read(int16_t* buffer, int32_t maxFrames) override
+    {
+        int32_t framesGot = 0;
+
+        while (framesGot < maxFrames) {
+            if (pendingPos == pending && !decodeFrame())
+                break;
+
+            auto const toCopy = std::min(maxFrames - framesGot, pending - pendingPos);
+
+            for (int32_t idx = 0; idx < toCopy; ++idx, ++pendingPos) {
+                *buffer++ = pcmL[pendingPos];
+                if (channels == 2)
+                    *buffer++ = pcmR[pendingPos];
+            }
+
+            framesGot += toCopy;
+        }
+
+        return framesGot;
+    }
+
+private:
+    static const constexpr size_t IN_BUF_SIZE = 16384; // bytes
+
+    // hip gives at most one frame per call, feed it more data until it does
+    bool decodeFrame()
+    {
+        for (;;) {
+            auto const samples = ::hip_decode1_headers(hip, inBuffer.data(), fed, pcmL, pcmR, &mp3data);
+            fed = 0;
+
+            if (samples < 0)
+                return false; // broken stream, keep what was decoded so far
+
+            if (samples > 0) {
+                pending    = samples;
+                pendingPos = 0;
+                return true;
+            }
+
+            if (isEof)
+                return false;
+
+            throttleRead(IN_BUF_SIZE);
+            file.read(reinterpret_cast<char*>(inBuffer.data()), IN_BUF_SIZE);
+            fed   = static_cast<size_t>(file.gcount());
+            isEof = fed == 0;
+        }
+    }
+
+    std::ifstream   file;
+    hip_t           hip;
+    mp3data_struct  mp3data    = {};
+    vector<uint8_t> inBuffer   = vector<uint8_t>(IN_BUF_SIZE, 0);
+    size_t          fed        = 0;
+    bool            isEof      = false;
+    int16_t         pcmL[1152] = {}; // one MPEG-1 layer III frame
+    int16_t         pcmR[1152] = {};
+    int32_t         pending    = 0;
+    int32_t         pendingPos = 0;
+};
+
+
+// PCM from a producer process through a shared memory ring, encoded in place
+class ShmSource : public PcmSource
+{
+public:
+    bool open(string const& shmName, string& error)
+    {
+        if (!ring.open(shmName, error))
+            return false;
+
+        sampleRate = ring.sampleRate();
+        channels   = ring.channels();
+        return true;
+    }
+
+    int32_t read(int16_t* buffer, int32_t maxFrames) override
+    {
+        int16_t const* data = nullptr;
+        auto const framesGot = acquire(data, buffer, maxFrames);
+        ::memcpy(buffer, data, framesGot * channels * sizeof(int16_t));
+        return framesGot;
+    }
+
+    // the previous view is handed back to the producer only now, when the encoder is done with it
+    int32_t acquire(int16_t const*& data, int16_t*, int32_t maxFrames) override
+    {
+        ring.release(acquired);
+        acquired = ring.acquire(data, maxFrames);
+        return acquired;
+    }
+
+private:
+    ShmRing ring;
+    int32_t acquired = 0;
+};
+
+
+// clip of a bundle, the encoder reads its PCM straight from the mapping
+class ClipSource : public PcmSource
+{
+public:
+    ClipSource(std::shared_ptr<Bundle const> bundle, BundleClip const& clip)
+        : bundle(std::move(bundle))
+        , pcm   (reinterpret_cast<int16_t const*>(this->bundle->pcm(clip)))
+    {
+        sampleRate = clip.sampleRate;
+        channels   = clip.channels;
+        frames     = static_cast<int64_t>(clip.bytes / (clip.channels * sizeof(int16_t)));
+    }
+
+    int32_t read(int16_t* buffer, int32_t maxFrames) override
+    {
+        int16_t const* data = nullptr;
+        auto const framesGot = acquire(data, buffer, maxFrames);
+        ::memcpy(buffer, data, framesGot * channels * sizeof(int16_t));
+        return framesGot;
+    }
+
+    int32_t acquire(int16_t const*& data, int16_t*, int32_t maxFrames) override
+    {
+        auto const framesGot = static_cast<int32_t>(std::min<int64_t>(maxFrames, frames - framesRead));
+
+        throttleRead(static_cast<size_t>(framesGot) * channels * sizeof(int16_t)); // page faults are reads too
+        data        = pcm + framesRead * channels;
+        framesRead += framesGot;
+        return framesGot;
+    }
+
+    bool seek(int64_t frame) override
+    {
+        framesRead = std::min(std::max<int64_t>(frame, 0), frames);
+        return true;
+    }
+
+private:
+    std::shared_ptr<Bundle const> bundle; // keeps the mapping
+    int16_t const*                pcm;
+    int64_t                       framesRead = 0;
+};
+
+
+// time range of another source, see limitSource()
+class RangeSource : public PcmSource
+{
+public:
+    RangeSource(std::unique_ptr<PcmSource> source, int64_t firstFrame, int64_t endFrame)
+        : inner(std::move(source))
+        , first(firstFrame)
+        , end(endFrame)
+    {
+        sampleRate = inner->sampleRate;
+        channels   = inner->channels;
+
+        if (inner->frames >= 0) {
+            end   = end < 0 ? inner->frames : std::min(end, inner->frames);
+            first = std::min(first, end);
+        }
+
+        frames = end >= 0 ? end - first : -1;
+        toSkip = first > 0 && !inner->seek(first) ? first : 0;
+    }
+
+    int32_t read(int16_t* buffer, int32_t maxFrames) override
+    {
+        int16_t const* data = nullptr;
+        auto const framesGot = acquire(data, buffer, maxFrames);
+
+        if (data != buffer)
+            ::memcpy(buffer, data, framesGot * channels * sizeof(int16_t));
+        return framesGot;
+    }
+
+    int32_t acquire(int16_t const*& data, int16_t* buffer, int32_t maxFrames) override
+    {
+        for (int32_t framesGot = 1; toSkip > 0 && framesGot > 0; toSkip -= framesGot)
+            framesGot = inner->acquire(data, buffer, static_cast<int32_t>(std::min<int64_t>(toSkip, maxFrames)));
+
+        if (toSkip > 0) // ended before the range
+            return 0;
+
+        if (end >= 0)
+            maxFrames = static_cast<int32_t>(std::min<int64_t>(maxFrames, end - first - position));
+
+        if (maxFrames <= 0)
+            return 0;
+
+        auto const framesGot = inner->acquire(data, buffer, maxFrames);
+        position += framesGot;
+        return framesGot;
+    }
+
+    bool seek(int64_t frame) override
+    {
+        if (!inner->seek(first + frame))
+            return false;
+
+        position = frame;
+        toSkip   = 0;
+        return true;
+    }
+
+private:
+    std::unique_ptr<PcmSource> inner;
+    int64_t                    first;
+    int64_t                    end;
+    int64_t                    position = 0; // frames given out from first on
+    int64_t                    toSkip   = 0; // frames before first still to read and drop
+};
+}
+
+
+// read PCM file into PcmHeader structure
+static PcmHeader readPcmHeader(std::ifstream& pcm)
+{
+    PcmHeader pcmHeader = {}; // short files leave the tail zeroed and invalid
+    static_assert(sizeof(PcmHeader) == 44, "Wrong PCM header structure!");
+    pcm.read(reinterpret_cast<char*>(&pcmHeader), sizeof(PcmHeader));
+    return pcmHeader;
+}
+
+
+// check if PCM header contains required data
+static bool isValid(PcmHeader const& h)
+{
+    return h.audioFormat   == 1
+        && h.bitsPerSample == 16 // transforming 8 bit to 16 resulting in an awful quality mp3
+        && h.numChannels    > 0
+        && h.blockAlign     > 0
+        && h.sampleRate     > 0
+        && h.bitsPerSample  > 0
+        && ::memcmp(h.subchunk2ID, "data", 4) == 0;
+}
+
+
+static string describeInvalid(PcmHeader const& h)
+{
+    if (h.audioFormat != 1)
+        return "Unsupported audio format";
+    if (h.bitsPerSample != 16)
+        return "Only 16 bit per sample is supported";
+    return "Broken header";
+}
+
+
+// skip ID3v2 tag if any, leave the stream at the first audio byte
+static void skipId3v2(std::ifstream& file)
+{
+    uint8_t tag[10] = { 0, };
+    file.read(reinterpret_cast<char*>(tag), sizeof(tag));
+
+    if (file.gcount() == sizeof(tag) && ::memcmp(tag, "ID3", 3) == 0) {
+        auto const size   = (tag[6] & 0x7f) << 21 | (tag[7] & 0x7f) << 14 | (tag[8] & 0x7f) << 7 | (tag[9] & 0x7f);
+        auto const footer = (tag[5] & 0x10) ? 10 : 0;
+        file.seekg(sizeof(tag) + size + footer);
+        return;
+    }
+
+    file.clear();
+    file.seekg(0);
+}
+
+
+static bool isMp3Sync(uint8_t const* bytes)
+{
+    return ::memcmp(bytes, "ID3", 3) == 0 || (bytes[0] == 0xff && (bytes[1] & 0xe0) == 0xe0);
+}
+
+
+std::unique_ptr<PcmSource> openSource(string const& fileName, bool isMp3Allowed, string& error, double followTimeout)
+{
+    if (isShmInput(fileName)) {
+        string shmName;
+        string outFileName;
+        parseShmInput(fileName, shmName, outFileName);
+        auto source = std::unique_ptr<ShmSource>(new ShmSource);
+
+        if (source->open(shmName, error))
+            return source;
+
+        return nullptr;
+    }
+
+    auto file = std::ifstream(fileName, std::ios_base::binary | std::ifstream::in);
+    uint8_t magic[4] = { 0, };
+
+    file.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    auto const compression = detectCompression(magic, static_cast<size_t>(file.gcount()));
+    file.clear();
+    file.seekg(0);
+
+    if (compression != Compression::None) { // by contents, the name may not say
+        auto      stream    = std::unique_ptr<DecompressStream>(new DecompressStream);
+        PcmHeader pcmHeader = {};
+
+        if (!stream->open(fileName, compression, error))
+            return nullptr;
+
+        stream->read(&pcmHeader, sizeof(PcmHeader));
+
+        if (!isValid(pcmHeader)) {
+            error = stream->isBroken() ? string("Corrupt ") + compressionName(compression) + " stream" : describeInvalid(pcmHeader);
+            return nullptr;
+        }
+
+        return std::unique_ptr<PcmSource>(new CompressedWavSource(std::move(stream), pcmHeader));
+    }
+
+    if (isMp3Allowed && isMp3Sync(magic)) {
+        skipId3v2(file);
+        auto source = std::unique_ptr<Mp3Source>(new Mp3Source(std::move(file)));
+
+        if (source->open())
+            return source;
+
+        error = "Can't decode MP3 stream";
+        return nullptr;
+    }
+
+    auto const pcmHeader = readPcmHeader(file);
+
+    if (!isValid(pcmHeader)) {
+        error = describeInvalid(pcmHeader);
+        return nullptr;
+    }
+
+    if (followTimeout > 0)
+        return std::unique_ptr<PcmSource>(new FollowSource(std::move(file), pcmHeader, fileName, followTimeout));
+
+    return std::unique_ptr<PcmSource>(new WavSource(std::move(file), pcmHeader));
+}
+
+
+std::unique_ptr<PcmSource> openClipSource(string const& bundleName, size_t clipIdx, string& error)
+{
+    auto const bundle = openBundle(bundleName, error);
+
+    if (!bundle)
+        return nullptr;
+
+    if (clipIdx >= bundle->clips().size()) {
+        error = "No clip " + std::to_string(clipIdx) + " in bundle";
+        return nullptr;
+    }
+
+    auto const& clip = bundle->clips()[clipIdx];
+
+    if (clip.format != BUNDLE_PCM16 || clip.channels == 0 || clip.sampleRate <= 0) {
+        error = "Unsupported format of clip " + clip.name;
+        return nullptr;
+    }
+
+    return std::unique_ptr<PcmSource>(new ClipSource(bundle, clip));
+}
+
+
+std::unique_ptr<PcmSource> limitSource(std::unique_ptr<PcmSource> source, int64_t firstFrame, int64_t endFrame)
+{
+    return std::unique_ptr<PcmSource>(new RangeSource(std::move(source), firstFrame, endFrame));
+}
@@ -0,0 +1,49 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+// producer of interleaved 16 bit PCM frames for a single job,
+// one frame is one sample of every channel
+class PcmSource
+{
+public:
+    virtual ~PcmSource() = default;
+
+    // read up to maxFrames frames into buffer (room for maxFrames * channels samples),
+    // returns the number of frames read, 0 at the end of data
+    virtual int32_t read(int16_t* buffer, int32_t maxFrames) = 0;
+
+    // zero copy variant of read: point data at up to maxFrames frames, valid
+    // until the next call; sources without PCM in memory read into buffer
+    virtual int32_t acquire(int16_t const*& data, int16_t* buffer, int32_t maxFrames)
+    {
+        data = buffer;
+        return read(buffer, maxFrames);
+    }
+
+    // continue reading from the given frame, false if the source is a stream
+    virtual bool seek(int64_t) { return false; }
+
+    int32_t sampleRate = 0;
+    int32_t channels   = 0;
+    int64_t frames     = -1; // declared length, -1 if not known up front
+};
+
+// open a WAV file, also a gzip or zstd compressed one (see decompress.hpp), or, if
+// allowed, an MP3 file decoded on the fly, the format is detected by the file contents; "shm:" names open a
+// shared memory PCM ring (see shmring.hpp); null with error set on failure;
+// followTimeout > 0 reads WAV files still being written, see FollowSource
+std::unique_ptr<PcmSource> openSource(std::string const& fileName, bool isMp3Allowed, std::string& error, double followTimeout = 0);
+
+// clip clipIdx of a bundle file (see bundle.hpp), read in place from the mapping
+// of the bundle, which all clips of it share
+std::unique_ptr<PcmSource> openClipSource(std::string const& bundleName, size_t clipIdx, std::string& error);
+
+// frames firstFrame .. endFrame - 1 of source, endFrame < 0 - up to the end; the source
+// is seeked to firstFrame if it can be, streams and MP3s are read up to it and dropped
+std::unique_ptr<PcmSource> limitSource(std::unique_ptr<PcmSource> source, int64_t firstFrame, int64_t endFrame);
+
+#endif // SOURCE_H
@@ -0,0 +1,49 @@
+#include <algorithm>
+
+#include "mp3frame.hpp"
+#include "split.hpp"
+
+using std::vector;
+
+static const constexpr int32_t PREROLL_FRAMES   = 4;  // filterbank, MDCT overlap and psy model history
+static const constexpr int32_t POSTROLL_FRAMES  = 2;  // psy model look ahead of the last kept frames
+static const constexpr int64_t MIN_PIECE_FRAMES = 64; // below that the pre-roll costs more than it saves
+
+
+vector<SplitPiece> planSplit(int64_t samples, int32_t frameSamples, int32_t pieceNum)
+{
+    auto const frames   = (samples + frameSamples - 1) / frameSamples;
+    auto const num      = std::max<int64_t>(1, std::min<int64_t>(pieceNum, frames / MIN_PIECE_FRAMES));
+    auto const perPiece = (frames + num - 1) / num * frameSamples;
+    vector<SplitPiece> pieces;
+
+    for (int64_t first = 0; first < samples || pieces.empty(); first += perPiece) {
+        auto const end       = std::min(samples, first + perPiece);
+        bool const isLast    = end == samples;
+        auto const readFirst = std::max<int64_t>(0, first - PREROLL_FRAMES * frameSamples);
+
+        pieces.push_back({ readFirst,
+                           isLast ? samples : std::min(samples, end + POSTROLL_FRAMES * frameSamples),
+                           static_cast<int32_t>((first - readFirst) / frameSamples),
+                           isLast ? -1 : perPiece / frameSamples });
+    }
+
+    return pieces;
+}
+
+
+vector<uint8_t> trimFrames(vector<uint8_t> const& mp3, int32_t dropFrames, int64_t keepFrames)
+{
+    Mp3FrameSplitter splitter;
+    uint8_t const*   frame = nullptr;
+    Mp3FrameInfo     info;
+    vector<uint8_t>  out;
+
+    splitter.add(mp3.data(), mp3.size());
+
+    for (int64_t idx = 0; splitter.next(frame, info) && (keepFrames < 0 || idx < dropFrames + keepFrames); ++idx)
+        if (idx >= dropFrames)
+            out.insert(out.end(), frame, frame + info.size);
+
+    return out;
+}
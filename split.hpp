@@ -0,0 +1,26 @@
+#ifndef SPLIT_H
+#define SPLIT_H
+
+#include <stdint.h>
+#include <vector>
+
+// one of the pieces a file is cut into to encode it on several threads at once;
+// with the bit reservoir off MP3 frames don't depend on each other, so pieces
+// encoded separately join into one stream if each starts on a frame boundary
+// and drops the frames of its pre-roll
+struct SplitPiece
+{
+    int64_t readFirst;  // first sample fed to the encoder, pre-roll included
+    int64_t readEnd;    // one past the last, post-roll included
+    int32_t dropFrames; // MP3 frames of the pre-roll
+    int64_t keepFrames; // MP3 frames after them belonging to the piece, -1 - all
+};
+
+// cut samples (per channel) into up to pieceNum frame aligned pieces,
+// short files get fewer pieces, at least one
+std::vector<SplitPiece> planSplit(int64_t samples, int32_t frameSamples, int32_t pieceNum);
+
+// MP3 frames dropFrames .. dropFrames + keepFrames - 1 of mp3, keepFrames -1 - up to the end
+std::vector<uint8_t> trimFrames(std::vector<uint8_t> const& mp3, int32_t dropFrames, int64_t keepFrames);
+
+#endif // SPLIT_H
@@ -0,0 +1,124 @@
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "analysis.hpp"
+
+static bool testChannelDifference()
+{
+    std::vector<int16_t> stereo(2 * 1003);
+    for (size_t frame = 0; frame < stereo.size() / 2; ++frame)
+        stereo[frame * 2] = stereo[frame * 2 + 1] = static_cast<int16_t>(frame * 37);
+
+    if (maxChannelDifference(stereo.data(), 1003) != 0)
+        return false;
+
+    stereo[2 * 1001 + 1] += 5; // in the scalar tail
+    stereo[2 * 500]      -= 9; // in the SIMD part
+    if (maxChannelDifference(stereo.data(), 1003) != 9)
+        return false;
+
+    stereo[0] = 32767; // saturates instead of wrapping
+    stereo[1] = -32768;
+    return maxChannelDifference(stereo.data(), 1003) == 32767;
+}
+
+static bool testSilence()
+{
+    std::vector<int16_t> samples(1001, 0);
+
+    if (maxAbsSample(samples.data(), 1001) != 0)
+        return false;
+
+    samples[1000] = -3; // scalar tail
+    samples[17]   = 2;
+    if (maxAbsSample(samples.data(), 1001) != 3)
+        return false;
+
+    samples[40] = -32768; // no overflow on negation
+    return maxAbsSample(samples.data(), 1001) == 32767;
+}
+
+static bool testBandwidth()
+{
+    const constexpr int32_t WINDOW = 2048;
+    const constexpr int32_t RATE   = 44100;
+
+    std::vector<int16_t> mono(4 * WINDOW);
+    for (size_t idx = 0; idx < mono.size(); ++idx) // 3 kHz tone
+        mono[idx] = static_cast<int16_t>(10000 * std::sin(2 * 3.14159265358979 * 3000 * idx / RATE));
+
+    auto const toneBandwidth = estimateBandwidth(mono.data(), WINDOW, 4, RATE);
+    if (toneBandwidth < 2900 || toneBandwidth > 3300)
+        return false;
+
+    uint32_t seed = 1;
+    for (auto& sample : mono) { // white noise fills the whole band
+        seed = seed * 1664525 + 1013904223;
+        sample = static_cast<int16_t>(seed >> 16);
+    }
+
+    if (estimateBandwidth(mono.data(), WINDOW, 4, RATE) < 20000)
+        return false;
+
+    std::fill(mono.begin(), mono.end(), 0);
+    return estimateBandwidth(mono.data(), WINDOW, 4, RATE) == 0
+        && pickOutSampleRate(toneBandwidth, RATE) == 8000
+        && pickOutSampleRate(10000, RATE)  == 24000
+        && pickOutSampleRate(15000, RATE)  == 0      // 44.1 kHz is the input rate already
+        && pickOutSampleRate(10000, 22050) == 0
+        && pickOutSampleRate(0, RATE)      == 0;
+}
+
+static bool testSpeech()
+{
+    const constexpr int32_t WINDOW = 4096;
+    const constexpr int32_t FRAME  = 512;
+    const constexpr double  TWO_PI = 2 * 3.14159265358979;
+
+    std::vector<int16_t> mono(8 * WINDOW);
+    uint32_t seed = 1;
+
+    for (size_t idx = 0; idx < mono.size(); ++idx) { // syllable, hiss, pause: 3 + 1 + 2 frames
+        auto const frame = idx / FRAME % 6;
+        seed = seed * 1664525 + 1013904223;
+
+        if (frame < 3)
+            mono[idx] = static_cast<int16_t>(6000 * std::sin(TWO_PI * 150 * idx / 16000) + 3000 * std::sin(TWO_PI * 450 * idx / 16000));
+        else if (frame == 3)
+            mono[idx] = static_cast<int16_t>(static_cast<int32_t>(seed >> 16) / 16 - 1024);
+        else
+            mono[idx] = static_cast<int16_t>(seed >> 29); // room noise
+    }
+
+    if (!isSpeech(measureContent(mono.data(), WINDOW, 8, FRAME)))
+        return false;
+
+    for (size_t idx = 0; idx < mono.size(); ++idx) // held chord
+        mono[idx] = static_cast<int16_t>(4000 * (std::sin(TWO_PI * 220 * idx / 16000) + std::sin(TWO_PI * 277 * idx / 16000)
+                                               + std::sin(TWO_PI * 330 * idx / 16000)));
+
+    return !isSpeech(measureContent(mono.data(), WINDOW, 8, FRAME));
+}
+
+int main(int argc, char** args)
+{
+    if (argc < 2)
+        return -1;
+
+    std::string const test = args[1];
+
+    if (test == "dual-mono")
+        return testChannelDifference() ? 0 : -1;
+
+    if (test == "silence")
+        return testSilence() ? 0 : -1;
+
+    if (test == "bandwidth")
+        return testBandwidth() ? 0 : -1;
+
+    if (test == "speech")
+        return testSpeech() ? 0 : -1;
+
+    return -1;
+}
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bundle.hpp"
+
+using std::string;
+using std::vector;
+
+struct Clip
+{
+    string          name;
+    int32_t         sampleRate;
+    int32_t         channels;
+    vector<int16_t> pcm;
+};
+
+
+static bool isSame(Bundle const& bundle, vector<Clip> const& clips)
+{
+    if (bundle.clips().size() != clips.size())
+        return false;
+
+    for (size_t idx = 0; idx < clips.size(); ++idx) {
+        auto const& clip  = clips[idx];
+        auto const& entry = bundle.clips()[idx];
+
+        if (entry.name != clip.name || entry.sampleRate != clip.sampleRate || entry.channels != clip.channels
+            || entry.format != BUNDLE_PCM16 || entry.bytes != clip.pcm.size() * sizeof(int16_t)
+            || ::memcmp(bundle.pcm(entry), clip.pcm.data(), entry.bytes) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+
+static bool pack(string const& name, vector<Clip> const& clips, string& error)
+{
+    BundleWriter writer;
+    if (!writer.open(name, error))
+        return false;
+
+    for (auto const& clip : clips) {
+        writer.addClip(clip.name, clip.sampleRate, clip.channels);
+        for (size_t first = 0; first < clip.pcm.size(); first += 4000)
+            writer.write(clip.pcm.data() + first, static_cast<int32_t>(std::min<size_t>(4000, clip.pcm.size() - first)) / clip.channels);
+    }
+
+    return writer.close(error);
+}
+
+
+// clips packed, mapped and read back in place; packed again under a mapping, which
+// stays whole, and mapped anew once let go; a cut bundle or another file is refused
+int main()
+{
+    auto const   name  = "test_bundle." + std::to_string(::getpid()) + ".e2mb";
+    vector<Clip> clips = { { "a.wav", 8000, 1, {} }, { "sub/b.wav", 44100, 2, {} }, { "empty.wav", 16000, 1, {} } };
+    string       error;
+
+    for (int32_t sample = 0; sample < 5000; ++sample)
+        clips[0].pcm.push_back(static_cast<int16_t>(sample * 7));
+    for (int32_t sample = 0; sample < 9000; ++sample) // more than a write
+        clips[1].pcm.push_back(static_cast<int16_t>(-sample));
+
+    bool isOk = pack(name, clips, error) && isBundleName(name) && !isBundleName(name + ".wav");
+
+    {
+        Bundle bundle;
+        isOk = isOk && bundle.open(name, error) && isSame(bundle, clips);
+    }
+
+    auto shared = openBundle(name, error);
+    isOk = isOk && shared && shared == openBundle(name, error) && isSame(*shared, clips); // mapped once
+
+    vector<Clip> const repacked = { clips[1] };
+    isOk = isOk && pack(name, repacked, error) && isSame(*shared, clips) && ::access((name + ".part").c_str(), F_OK) != 0;
+    shared.reset();
+    shared = openBundle(name, error);
+    isOk = isOk && shared && isSame(*shared, repacked);
+    shared.reset();
+
+    std::vector<char> bytes;
+    {
+        std::ifstream file(name, std::ios_base::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    for (auto const size : { bytes.size() - 3, static_cast<size_t>(10) }) { // cut in the index, in the header
+        std::ofstream(name, std::ios_base::binary | std::ios_base::trunc).write(bytes.data(), static_cast<std::streamsize>(size));
+        Bundle bundle;
+        isOk = isOk && !bundle.open(name, error);
+    }
+
+    bytes[0] = 'X';
+    std::ofstream(name, std::ios_base::binary | std::ios_base::trunc).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    Bundle bundle;
+    isOk = isOk && !bundle.open(name, error);
+
+    ::remove(name.c_str());
+    return isOk ? 0 : -1;
+}
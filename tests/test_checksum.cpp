@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <vector>
+#include <string.h>
+
+#include "checksum.hpp"
+
+// bit by bit reference
+static uint32_t crc32cReference(uint8_t const* data, size_t size)
+{
+    uint32_t crc = ~0u;
+    while (size--) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (0x82f63b78 & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+int main()
+{
+    char const* check = "123456789";
+    if (crc32c(0, check, ::strlen(check)) != 0xe3069283) // check value of the CRC-32C catalogue
+        return -1;
+
+    std::vector<uint8_t> data(100003);
+    uint32_t seed = 1;
+    for (auto& byte : data) {
+        seed = seed * 1103515245 + 12345;
+        byte = static_cast<uint8_t>(seed >> 16);
+    }
+
+    auto const expected = crc32cReference(data.data(), data.size());
+    if (crc32c(0, data.data(), data.size()) != expected)
+        return -1;
+
+    uint32_t crc = 0; // incremental over odd sized, unaligned chunks
+    for (size_t pos = 0, chunk = 1; pos < data.size(); pos += chunk, chunk = chunk * 7 % 4099 + 1)
+        crc = crc32c(crc, data.data() + pos, std::min(chunk, data.size() - pos));
+
+    if (crc != expected)
+        return -1;
+
+    for (size_t const split : { size_t(0), size_t(1), size_t(417), data.size() / 2, data.size() }) { // A + B from their own CRCs
+        auto const crcA = crc32c(0, data.data(), split);
+        auto const crcB = crc32c(0, data.data() + split, data.size() - split);
+        if (crc32c_combine(crcA, crcB, data.size() - split) != expected)
+            return -1;
+    }
+
+    auto tagged = data; // first 417 bytes replaced, as an Info tag over its placeholder
+    std::fill(tagged.begin(), tagged.begin() + 417, 0x5a);
+    auto const crcSwap = crc32c(0, tagged.data(), 417) ^ crc32c(0, data.data(), 417);
+
+    return crc32c_combine(crcSwap, expected, data.size() - 417) == crc32c(0, tagged.data(), tagged.size()) ? 0 : -1;
+}
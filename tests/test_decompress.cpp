@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "decompress.hpp"
+#include "pool.hpp"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using std::string;
+using std::vector;
+
+// host application's pool: a queue served by a fixed number of threads; with
+// none, all of its threads are busy elsewhere and tasks run only on the way out
+class HostPool : public Executor
+{
+public:
+    explicit HostPool(size_t threadNum)
+    {
+        for (size_t idx = 0; idx < threadNum; ++idx)
+            threads.emplace_back([this] { serve(); });
+    }
+
+    ~HostPool() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            isStopping = true;
+        }
+        cnd.notify_all();
+        for (auto& thread : threads)
+            thread.join();
+        for (auto const& task : tasks) // left without threads, their streams are closed by now
+            task.first(task.second);
+    }
+
+    void submit(TaskFunc func, void* arg) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            tasks.emplace_back(func, arg);
+        }
+        ++submitted;
+        cnd.notify_one();
+    }
+
+    size_t concurrency() const override { return std::max<size_t>(threads.size(), 1); }
+
+    std::atomic<size_t> submitted { 0 };
+
+private:
+    void serve()
+    {
+        for (;;) {
+            std::unique_lock<std::mutex> lock(mtx);
+            cnd.wait(lock, [this] { return isStopping || !tasks.empty(); });
+
+            if (tasks.empty())
+                return;
+
+            auto const task = tasks.front();
+            tasks.pop_front();
+            lock.unlock();
+            task.first(task.second);
+        }
+    }
+
+    std::mutex                             mtx;
+    std::condition_variable                cnd;
+    std::deque<std::pair<TaskFunc, void*>> tasks;
+    std::vector<std::thread>               threads;
+    bool                                   isStopping = false;
+};
+
+
+// some 1.5 MB of a slowly changing signal, compressible like PCM is
+static vector<uint8_t> makeData()
+{
+    vector<uint8_t> data(1500 * 1000 + 7);
+    uint32_t        state = 1;
+    int32_t         level = 0;
+
+    for (size_t idx = 0; idx < data.size(); ++idx) {
+        state  = state * 1664525 + 1013904223;
+        level += static_cast<int32_t>(state >> 29) - 3;
+        data[idx] = static_cast<uint8_t>(level);
+    }
+
+    return data;
+}
+
+
+// data in 2 gzip members or zstd frames, decoders have to read on into the second
+static bool compress(string const& kind, vector<uint8_t> const& data, vector<uint8_t>& packed)
+{
+    auto const half = data.size() / 2;
+    uint8_t const* parts[]    = { data.data(), data.data() + half };
+    size_t const   partSize[] = { half, data.size() - half };
+
+    packed.clear();
+
+    for (int32_t part = 0; part < 2; ++part) {
+#ifdef HAVE_ZLIB
+        if (kind == "gzip") {
+            z_stream zs = {};
+            if (::deflateInit2(&zs, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                return false;
+
+            vector<uint8_t> out(::deflateBound(&zs, static_cast<uLong>(partSize[part])) + 64);
+            zs.next_in   = const_cast<uint8_t*>(parts[part]);
+            zs.avail_in  = static_cast<uInt>(partSize[part]);
+            zs.next_out  = out.data();
+            zs.avail_out = static_cast<uInt>(out.size());
+
+            bool const isDone = ::deflate(&zs, Z_FINISH) == Z_STREAM_END;
+            packed.insert(packed.end(), out.data(), out.data() + zs.total_out);
+            ::deflateEnd(&zs);
+
+            if (!isDone)
+                return false;
+            continue;
+        }
+#endif
+#ifdef HAVE_ZSTD
+        if (kind == "zstd") {
+            vector<uint8_t> out(::ZSTD_compressBound(partSize[part]));
+            auto const size = ::ZSTD_compress(out.data(), out.size(), parts[part], partSize[part], 3);
+
+            if (::ZSTD_isError(size))
+                return false;
+
+            packed.insert(packed.end(), out.data(), out.data() + size);
+            continue;
+        }
+#endif
+        return false;
+    }
+
+    return true;
+}
+
+
+#ifdef HAVE_ZLIB
+// gzip file whose first 64 KiB input block decodes to exactly one 256 KiB
+// output chunk: zeros, then a stored block ending on both boundaries, then a
+// stored block after them; the name field pads the header to fit
+static bool makeBoundaryGzip(vector<uint8_t>& data, vector<uint8_t>& packed)
+{
+    const constexpr size_t INPUT_SIZE = 64 * 1024; // as decompress.cpp reads and hands over
+    const constexpr size_t CHUNK_SIZE = 256 * 1024;
+    const constexpr size_t ZERO_SIZE  = 200 * 1000;
+
+    auto const tail = makeData();
+    data.assign(ZERO_SIZE, 0);
+    data.insert(data.end(), tail.begin(), tail.begin() + CHUNK_SIZE - ZERO_SIZE + 1000);
+
+    z_stream zs = {};
+    if (::deflateInit2(&zs, 9, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) // raw deflate
+        return false;
+
+    vector<uint8_t> zeros(1024);
+    zs.next_in   = data.data();
+    zs.avail_in  = static_cast<uInt>(ZERO_SIZE);
+    zs.next_out  = zeros.data();
+    zs.avail_out = static_cast<uInt>(zeros.size());
+
+    bool const isFlushed = ::deflate(&zs, Z_SYNC_FLUSH) == Z_OK && zs.avail_in == 0 && zs.avail_out > 0; // byte aligned after it
+    zeros.resize(zs.total_out);
+    ::deflateEnd(&zs);
+
+    auto const storeBlock = [&packed, &data](size_t pos, size_t size, uint8_t isLast) {
+        uint8_t const header[] = { isLast, static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8),
+                                   static_cast<uint8_t>(~size), static_cast<uint8_t>(~size >> 8) };
+        packed.insert(packed.end(), header, header + sizeof(header));
+        packed.insert(packed.end(), data.begin() + pos, data.begin() + pos + size);
+    };
+
+    auto const firstStored = CHUNK_SIZE - ZERO_SIZE;
+    auto const headerSize  = INPUT_SIZE - zeros.size() - 5 - firstStored;
+    if (!isFlushed || headerSize < 11)
+        return false;
+
+    uint8_t const gzipHeader[] = { 0x1f, 0x8b, 8, 8, 0, 0, 0, 0, 0, 3 }; // flags: a name follows
+    packed.assign(gzipHeader, gzipHeader + sizeof(gzipHeader));
+    packed.resize(headerSize - 1, 'a');
+    packed.push_back(0);
+    packed.insert(packed.end(), zeros.begin(), zeros.end());
+    storeBlock(ZERO_SIZE, firstStored, 0);
+    storeBlock(CHUNK_SIZE, data.size() - CHUNK_SIZE, 1);
+
+    auto const crc = ::crc32(0, data.data(), static_cast<uInt>(data.size()));
+    for (auto const value : { static_cast<uint32_t>(crc), static_cast<uint32_t>(data.size()) })
+        for (int32_t shift = 0; shift < 32; shift += 8)
+            packed.push_back(static_cast<uint8_t>(value >> shift));
+
+    return packed.size() > INPUT_SIZE;
+}
+#endif
+
+
+static bool writeFile(string const& name, vector<uint8_t> const& data)
+{
+    std::ofstream file(name, std::ios_base::binary);
+    file.write(reinterpret_cast<char const*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+
+// whole file read back in odd sized pieces
+static bool readAll(string const& name, Compression compression, vector<uint8_t>& data, bool& isBroken)
+{
+    DecompressStream stream;
+    string           error;
+
+    if (!stream.open(name, compression, error))
+        return false;
+
+    data.clear();
+    vector<uint8_t> piece(1000);
+
+    for (size_t got; (got = stream.read(piece.data(), piece.size())) > 0;)
+        data.insert(data.end(), piece.begin(), piece.begin() + got);
+
+    isBroken = stream.isBroken();
+    return true;
+}
+
+
+// argv[1] - gzip or zstd, argv[2] - host: decoded on a host pool of 2 threads,
+// stalled: on a host pool with no thread free, the reader decodes; none - own thread
+int main(int argNum, char** args)
+{
+    if (argNum < 2)
+        return -1;
+
+    string const mode = argNum > 2 ? args[2] : "none";
+    auto const   host = mode == "none" ? nullptr : std::unique_ptr<HostPool>(new HostPool(mode == "host" ? 2 : 0));
+    setExecutor(host.get());
+
+    string const      kind        = args[1];
+    Compression const compression = kind == "gzip" ? Compression::Gzip : Compression::Zstd;
+    auto const        name        = "test_decompress." + std::to_string(::getpid()) + "." + kind;
+    string            error;
+
+    if (!isCompressionAvailable(compression)) { // not built in has to be said, not guessed at
+        DecompressStream stream;
+        return !stream.open(name, compression, error) && !error.empty() ? 0 : -1;
+    }
+
+    auto const      data = makeData();
+    vector<uint8_t> packed;
+    vector<uint8_t> unpacked;
+    bool            isBroken = true;
+
+    if (!compress(kind, data, packed) || detectCompression(packed.data(), packed.size()) != compression)
+        return -1;
+
+    bool isOk = writeFile(name, packed) && readAll(name, compression, unpacked, isBroken) && !isBroken && unpacked == data;
+
+    { // reader gone before the end, the decoder mustn't hang on a full queue
+        DecompressStream stream;
+        uint8_t          head[10];
+        isOk = isOk && stream.open(name, compression, error) && stream.read(head, sizeof(head)) == sizeof(head)
+                    && ::memcmp(head, data.data(), sizeof(head)) == 0;
+    }
+
+    packed.resize(packed.size() * 3 / 4); // cut in the middle of the second part
+    isOk = isOk && writeFile(name, packed) && readAll(name, compression, unpacked, isBroken)
+                && isBroken && unpacked.size() < data.size();
+
+#ifdef HAVE_ZLIB
+    if (compression == Compression::Gzip) { // no more output exactly where the input block ends isn't an error
+        vector<uint8_t> boundary;
+        isOk = isOk && makeBoundaryGzip(boundary, packed) && writeFile(name, packed)
+                    && readAll(name, compression, unpacked, isBroken) && !isBroken && unpacked == boundary;
+    }
+#endif
+
+    ::remove(name.c_str());
+    setExecutor(nullptr);
+    return isOk && (!host || host->submitted > 0) ? 0 : -1;
+}
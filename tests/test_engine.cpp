@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "encode2mp3.hpp"
+#include "pool.hpp"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using std::string;
+using std::vector;
+
+// host application's pool: a queue served by a fixed number of threads
+class HostPool : public Executor
+{
+public:
+    explicit HostPool(size_t threadNum)
+    {
+        for (size_t idx = 0; idx < threadNum; ++idx)
+            threads.emplace_back([this] { serve(); });
+    }
+
+    ~HostPool() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            isStopping = true;
+        }
+        cnd.notify_all();
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    void submit(TaskFunc func, void* arg) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            tasks.emplace_back(func, arg);
+        }
+        cnd.notify_one();
+    }
+
+    size_t concurrency() const override { return threads.size(); }
+
+private:
+    void serve()
+    {
+        for (;;) {
+            std::unique_lock<std::mutex> lock(mtx);
+            cnd.wait(lock, [this] { return isStopping || !tasks.empty(); });
+
+            if (tasks.empty())
+                return;
+
+            auto const task = tasks.front();
+            tasks.pop_front();
+            lock.unlock();
+            task.first(task.second);
+        }
+    }
+
+    std::mutex                             mtx;
+    std::condition_variable                cnd;
+    std::deque<std::pair<TaskFunc, void*>> tasks;
+    std::vector<std::thread>               threads;
+    bool                                   isStopping = false;
+};
+
+
+static vector<char> readFile(string const& name)
+{
+    std::ifstream file(name, std::ios_base::binary);
+    return vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+
+static bool writeFile(string const& name, vector<char> const& data)
+{
+    std::ofstream file(name, std::ios_base::binary);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+
+// the engine as an application embeds it: the WAV of argv[1] and a gzip copy
+// of it in a folder, encoded on the host's threads to the same MP3
+int main(int argNum, char** args)
+{
+    if (argNum != 2)
+        return -1;
+
+    auto const     wav   = readFile(args[1]);
+    auto const     dir   = "test_engine." + std::to_string(::getpid());
+    vector<string> names = { dir + "/plain.wav" };
+    bool           isOk  = !wav.empty() && ::mkdir(dir.c_str(), 0755) == 0 && writeFile(names[0], wav);
+
+#ifdef HAVE_ZLIB
+    names.push_back(dir + "/packed.wav.gz");
+    auto const packed = ::gzopen(names[1].c_str(), "wb");
+    isOk = isOk && packed && ::gzwrite(packed, wav.data(), static_cast<unsigned>(wav.size())) == static_cast<int>(wav.size());
+    isOk = packed && ::gzclose(packed) == Z_OK && isOk;
+#endif
+
+    HostPool host(2);
+    Options  options;
+    options.inputs = { dir };
+    setExecutor(&host);
+
+    auto const jobs    = isOk ? collectJobs(options) : vector<Job>();
+    auto const results = encodeJobs(jobs, options);
+    setExecutor(nullptr);
+
+    isOk = isOk && jobs.size() == names.size() && results.size() == jobs.size()
+                && std::all_of(results.begin(), results.end(), [](JobResult const& result) { return result.isEncoded; });
+    isOk = isOk && readFile(dir + "/plain.mp3").size() > 0;
+    isOk = isOk && (names.size() == 1 || readFile(dir + "/plain.mp3") == readFile(dir + "/packed.mp3"));
+
+    for (auto const& name : { names.back(), names.front(), dir + "/plain.mp3", dir + "/packed.mp3" })
+        ::remove(name.c_str());
+    ::rmdir(dir.c_str());
+    return isOk ? 0 : -1;
+}
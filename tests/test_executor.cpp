@@ -0,0 +1,144 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <stdlib.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "pool.hpp"
+
+// host application's pool: a queue served by a fixed number of threads
+class HostPool : public Executor
+{
+public:
+    explicit HostPool(size_t threadNum)
+    {
+        for (size_t idx = 0; idx < threadNum; ++idx)
+            threads.emplace_back([this] { serve(); });
+    }
+
+    ~HostPool() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            isStopping = true;
+        }
+        cnd.notify_all();
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    void submit(TaskFunc func, void* arg) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            tasks.emplace_back(func, arg);
+        }
+        cnd.notify_one();
+    }
+
+    size_t concurrency() const override { return threads.size(); }
+
+    bool isHostThread(std::thread::id id) const
+    {
+        for (auto const& thread : threads)
+            if (thread.get_id() == id)
+                return true;
+        return false;
+    }
+
+private:
+    void serve()
+    {
+        for (;;) {
+            std::unique_lock<std::mutex> lock(mtx);
+            cnd.wait(lock, [this] { return isStopping || !tasks.empty(); });
+
+            if (tasks.empty()) // drained before stopping, late pool workers still run
+                return;
+
+            auto const task = tasks.front();
+            tasks.pop_front();
+            lock.unlock();
+            task.first(task.second);
+        }
+    }
+
+    std::mutex                                 mtx;
+    std::condition_variable                    cnd;
+    std::deque<std::pair<TaskFunc, void*>>     tasks;
+    std::vector<std::thread>                   threads;
+    bool                                       isStopping = false;
+};
+
+
+const constexpr size_t OUTER_JOBS = 40;
+const constexpr size_t INNER_JOBS = 6;
+
+struct Run
+{
+    HostPool*                       host;
+    std::thread::id                 caller;
+    std::vector<std::atomic<int>>   counts = std::vector<std::atomic<int>>(OUTER_JOBS * INNER_JOBS);
+    std::atomic<int>                foreignThreads { 0 };
+};
+
+struct Inner
+{
+    Run*   run;
+    size_t outer;
+};
+
+static void checkThread(Run& run)
+{
+    auto const id = std::this_thread::get_id();
+    if (id != run.caller && !run.host->isHostThread(id))
+        ++run.foreignThreads;
+}
+
+static void innerJob(size_t jobIdx, void* ctx)
+{
+    auto& inner = *static_cast<Inner*>(ctx);
+    checkThread(*inner.run);
+    ++inner.run->counts[inner.outer * INNER_JOBS + jobIdx];
+}
+
+static void outerJob(size_t jobIdx, void* ctx)
+{
+    auto& run = *static_cast<Run*>(ctx);
+    Inner inner = { &run, jobIdx };
+    checkThread(run);
+    runPool(INNER_JOBS, INNER_JOBS, &innerJob, &inner); // like --split pieces inside a file job
+}
+
+// jobs with nested pools run once each and only on the host's threads or the
+// caller's, also with a single host thread, where nested pools must not starve
+int main(int argNum, char** args)
+{
+    if (argNum != 2)
+        return -1;
+
+    HostPool host(static_cast<size_t>(::atoi(args[1])));
+    Run      run;
+    run.host   = &host;
+    run.caller = std::this_thread::get_id();
+
+    setExecutor(&host);
+    if (defaultWorkerNum() != host.concurrency())
+        return -1;
+
+    auto const stats = runPool(OUTER_JOBS, 16, &outerJob, &run);
+    setExecutor(nullptr);
+
+    if (stats.busySeconds.size() != std::min<size_t>(16, host.concurrency()) || run.foreignThreads != 0)
+        return -1;
+
+    for (auto const& count : run.counts)
+        if (count != 1)
+            return -1;
+
+    return 0;
+}
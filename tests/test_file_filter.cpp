@@ -6,7 +6,7 @@ int main(int argc, char** args)
         return -1;
 
     std::vector<std::string> const extentions = {"wav", "pcm", "wave"};
-    auto const& files = filterFiles(getCanonicalDirContents(args[2]), extentions);
+    auto const& files = expandInput(args[2], extentions);
 
     try {
         size_t const numFiles = std::stoi(args[1]);
@@ -0,0 +1,58 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdio.h>
+
+#include "hls.hpp"
+#include "mp3frame.hpp"
+
+static std::string readAll(std::string const& name)
+{
+    std::ifstream file(name, std::ios_base::binary);
+    std::ostringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+// lame's tag placeholder and 100 frames of 26.1 ms in pieces cutting through frames
+// go out as 38 + 38 + 24 frames in 1 s segments, without the placeholder; the
+// playlist lists them as they're done
+int main()
+{
+    std::string const dir   = "test_hls.hls";
+    auto const        frame = makeSilentMp3Frame(44100, 2);
+    std::string       stream("junk");
+
+    stream.append(frame.begin(), frame.end()); // header and zeros, as lame starts a stream
+    for (int32_t idx = 0; idx < 100; ++idx)
+        stream.append(frame.begin(), frame.end());
+
+    HlsSegmenter segmenter(dir, 1.0);
+    segmenter.setTagFirst(true);
+    auto const   data = reinterpret_cast<uint8_t const*>(stream.data());
+
+    for (size_t first = 0; first < stream.size(); first += 1000)
+        if (!segmenter.write(data + first, std::min<size_t>(1000, stream.size() - first)))
+            return -1;
+
+    auto const playlist = readAll(segmenter.playlistName());
+    if (playlist.find("00001.mp3") == std::string::npos || playlist.find("#EXT-X-ENDLIST") != std::string::npos)
+        return -1;
+
+    if (!segmenter.finish())
+        return -1;
+
+    bool const isOk = readAll(dir + "/00000.mp3").size() == 38 * frame.size()
+                   && readAll(dir + "/00001.mp3").size() == 38 * frame.size()
+                   && readAll(dir + "/00002.mp3").size() == 24 * frame.size()
+                   && readAll(segmenter.playlistName()) ==
+                          "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:1\n#EXT-X-MEDIA-SEQUENCE:0\n"
+                          "#EXT-X-PLAYLIST-TYPE:VOD\n#EXTINF:0.993,\n00000.mp3\n#EXTINF:0.993,\n00001.mp3\n"
+                          "#EXTINF:0.627,\n00002.mp3\n#EXT-X-ENDLIST\n";
+
+    for (auto const& name : { "/00000.mp3", "/00001.mp3", "/00002.mp3", "/playlist.m3u8" })
+        ::remove((dir + name).c_str());
+    ::remove(dir.c_str());
+
+    return isOk ? 0 : -1;
+}
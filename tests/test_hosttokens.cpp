@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "hosttokens.hpp"
+
+// 6 threads, each with its own token like separate processes would have,
+// share 2 tokens: never more than 2 held at once, and 2 are held at times
+int main()
+{
+    const constexpr size_t TOKENS = 2;
+
+    auto const  dir = "/tmp/test_hosttokens." + std::to_string(::getpid());
+    std::string error;
+
+    if (!setHostTokens(dir, TOKENS, error) || !isHostTokens())
+        return -1;
+
+    std::atomic<int> held(0);
+    std::atomic<int> maxHeld(0);
+    std::vector<std::thread> threads;
+
+    for (int32_t thread = 0; thread < 6; ++thread)
+        threads.emplace_back([&] {
+            for (int32_t round = 0; round < 5; ++round) {
+                acquireHostToken();
+                acquireHostToken(); // has one already, no second
+
+                auto const now = ++held;
+                auto       max = maxHeld.load();
+                while (now > max && !maxHeld.compare_exchange_weak(max, now)) {}
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                --held;
+                releaseHostToken();
+            }
+        });
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (size_t slot = 0; slot < TOKENS; ++slot)
+        ::remove((dir + "/slot." + std::to_string(slot)).c_str());
+    ::rmdir(dir.c_str());
+
+    return maxHeld == static_cast<int>(TOKENS) && hostTokenWaitSeconds() > 0 ? 0 : -1;
+}
@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <vector>
+
+#include "mp3frame.hpp"
+
+// silent frames must parse back to what was asked for and carry no audio data
+int main()
+{
+    int32_t const rates[] = { 8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000 };
+
+    for (auto const rate : rates) {
+        for (int32_t channels = 1; channels <= 2; ++channels) {
+            auto const frame = makeSilentMp3Frame(rate, channels);
+            Mp3FrameInfo info;
+
+            if (frame.empty() || !parseMp3FrameHeader(frame.data(), info))
+                return -1;
+
+            if (info.sampleRate != rate || info.channels != channels || info.size != static_cast<int32_t>(frame.size()))
+                return -1;
+
+            if (info.samples != (rate >= 32000 ? 1152 : 576))
+                return -1;
+
+            auto const sideInfo = rate >= 32000 ? (channels == 1 ? 17 : 32) : (channels == 1 ? 9 : 17);
+            if (info.size < 4 + sideInfo || std::any_of(frame.begin() + 4, frame.end(), [](uint8_t b) { return b != 0; }))
+                return -1;
+        }
+    }
+
+    uint8_t const mpeg1Header[4] = { 0xff, 0xfb, 0x90, 0x64 }; // 128 kbps, 44.1 kHz, joint stereo
+    Mp3FrameInfo info;
+
+    if (!parseMp3FrameHeader(mpeg1Header, info) || info.size != 417 || info.bitrate != 128 || info.channels != 2)
+        return -1;
+
+    // lame's InitVbrTag() reserves the tag frame as the header and zeros,
+    // the tag itself (an "Info" id after the side info) comes at the end
+    std::vector<uint8_t> placeholder(mpeg1Header, mpeg1Header + 4);
+    placeholder.resize(417, 0);
+    auto tag = placeholder;
+    std::copy_n("Info", 4, tag.begin() + 4 + 32);
+    auto audio = placeholder;
+    audio[200] = 0x5a;
+
+    if (!isTagPlaceholderFrame(placeholder.data(), placeholder.size(), info) || !isTagPlaceholderFrame(tag.data(), tag.size(), info)
+        || isTagPlaceholderFrame(audio.data(), audio.size(), info) || isTagPlaceholderFrame(placeholder.data(), 64, info))
+        return -1;
+
+    return makeSilentMp3Frame(96000, 2).empty() ? 0 : -1;
+}
@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "peaks.hpp"
+
+// compare SIMD peaks built from odd sized chunks with a plain loop over the whole signal
+int main(int argc, char** args)
+{
+    if (argc < 2)
+        return -1;
+
+    int32_t const channels       = std::stoi(args[1]);
+    int32_t const frames         = 10007;
+    int32_t const samplesPerPeak = 100;
+    std::vector<int16_t> signal(frames * channels);
+
+    uint32_t seed = 12345;
+    for (auto& sample : signal) {
+        seed   = seed * 1103515245 + 12345;
+        sample = static_cast<int16_t>(seed >> 16);
+    }
+
+    PeakBuilder builder(8000, channels, samplesPerPeak, 3);
+
+    for (int32_t pos = 0, chunk = 1; pos < frames; pos += chunk, chunk = chunk * 3 % 997 + 1)
+        builder.add(signal.data() + pos * channels, std::min(chunk, frames - pos));
+
+    builder.finish();
+    auto const& levels = builder.levels();
+
+    if (levels.size() != 3)
+        return -1;
+
+    for (auto const& level : levels) {
+        auto const peakNum = (frames + level.samplesPerPeak - 1) / level.samplesPerPeak;
+
+        if (level.peaks.size() != static_cast<size_t>(peakNum * channels * 2))
+            return -1;
+
+        for (int32_t peak = 0; peak < peakNum; ++peak) {
+            for (int32_t ch = 0; ch < channels; ++ch) {
+                int16_t peakMin = 32767;
+                int16_t peakMax = -32768;
+
+                for (int32_t frame = peak * level.samplesPerPeak; frame < std::min(frames, (peak + 1) * level.samplesPerPeak); ++frame) {
+                    peakMin = std::min(peakMin, signal[frame * channels + ch]);
+                    peakMax = std::max(peakMax, signal[frame * channels + ch]);
+                }
+
+                if (level.peaks[(peak * channels + ch) * 2] != peakMin || level.peaks[(peak * channels + ch) * 2 + 1] != peakMax)
+                    return -1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "procpool.hpp"
+
+const constexpr size_t CRASH_JOB = 3; // worker killed by a signal
+const constexpr size_t EXIT_JOB  = 7; // worker exits with an error
+
+static std::string outName(void* ctx, size_t jobIdx)
+{
+    return *static_cast<std::string*>(ctx) + "." + std::to_string(jobIdx);
+}
+
+
+// every job writes its file first, the crashing ones die with it half done
+static void squareJob(size_t jobIdx, void* result, void* ctx)
+{
+    std::ofstream(outName(ctx, jobIdx)) << jobIdx;
+
+    if (jobIdx == CRASH_JOB)
+        ::raise(SIGKILL);
+    if (jobIdx == EXIT_JOB)
+        ::_exit(3);
+
+    ::usleep(2000); // the queue outlasts the crashes, so both workers are replaced
+    uint64_t const square = jobIdx * jobIdx;
+    ::memcpy(result, &square, sizeof(square));
+}
+
+
+static void dropOutput(size_t jobIdx, void* ctx)
+{
+    ::remove(outName(ctx, jobIdx).c_str());
+}
+
+
+// results of all jobs come back from argv[1] worker processes, except of the
+// 2 that take their worker down; those are reported, their files removed and
+// the workers replaced
+int main(int argNum, char** args)
+{
+    if (argNum < 2)
+        return -1;
+
+    const constexpr size_t JOB_NUM = 40;
+
+    auto const           processNum = static_cast<size_t>(::atoi(args[1]));
+    std::vector<uint8_t> results;
+    std::vector<uint8_t> isDone;
+    ProcessStats         stats;
+    std::string          error;
+    std::string          prefix     = "test_procpool." + std::to_string(::getpid());
+
+    if (!isProcessPoolSupported()) // refused, with a reason
+        return !runProcessPool(JOB_NUM, processNum, sizeof(uint64_t), &squareJob, &dropOutput, &prefix, false, results, isDone,
+                               stats, error) && !error.empty() ? 0 : -1;
+
+    if (!runProcessPool(JOB_NUM, processNum, sizeof(uint64_t), &squareJob, &dropOutput, &prefix, false, results, isDone, stats, error))
+        return -1;
+
+    bool isOk = true;
+
+    for (size_t jobIdx = 0; jobIdx < JOB_NUM; ++jobIdx) {
+        uint64_t square = 0;
+        ::memcpy(&square, results.data() + jobIdx * sizeof(square), sizeof(square));
+
+        bool const isLost   = jobIdx == CRASH_JOB || jobIdx == EXIT_JOB;
+        bool const isOutput = ::remove(outName(&prefix, jobIdx).c_str()) == 0;
+        isOk = isOk && isDone[jobIdx] == (isLost ? 0 : 1) && isOutput == !isLost && (isLost || square == jobIdx * jobIdx);
+    }
+
+    std::sort(stats.crashedJobs.begin(), stats.crashedJobs.end());
+    return isOk && stats.crashedJobs == std::vector<size_t>{ CRASH_JOB, EXIT_JOB } && stats.respawns == 2
+        && stats.busySeconds.size() == processNum ? 0 : -1;
+}
@@ -0,0 +1,97 @@
+#include <fstream>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "encoder.hpp"
+#include "mp3frame.hpp"
+#include "seekindex.hpp"
+
+// a tone encoded by lame as encode2mp3 writes it, indexed while encoding: the
+// first frame is the zeroed Info tag placeholder and the entries start after it
+static bool checkLameIndex()
+{
+    const constexpr int32_t SAMPLE_RATE   = 44100;
+    const constexpr int32_t FRAME_SAMPLES = 1152;
+    const constexpr int32_t BLOCK         = 4096;
+
+    EncoderSettings settings;
+    settings.inSampleRate = SAMPLE_RATE;
+    settings.bitrate      = 128;
+
+    std::string error;
+    auto const  encoder = makeEncoder(EncoderKind::Lame, settings, error);
+
+    if (!encoder)
+        return false;
+
+    std::vector<int16_t> pcm(BLOCK * 2);
+    std::vector<uint8_t> buffer(BLOCK * 2 + 7200);
+    std::vector<uint8_t> mp3;
+    SeekIndexBuilder     index(10);
+
+    index.setTagFirst(true);
+    for (int32_t first = 0; first < 3 * SAMPLE_RATE; first += BLOCK) {
+        for (int32_t frame = 0; frame < BLOCK; ++frame)
+            pcm[frame * 2] = pcm[frame * 2 + 1] = static_cast<int16_t>(8000 * ::sin(2 * 3.14159265358979 * 440 * (first + frame) / SAMPLE_RATE));
+
+        auto const size = encoder->encode(pcm.data(), BLOCK, buffer.data(), static_cast<int32_t>(buffer.size()));
+        if (size < 0)
+            return false;
+
+        index.add(buffer.data(), static_cast<size_t>(size));
+        mp3.insert(mp3.end(), buffer.begin(), buffer.begin() + size);
+    }
+
+    Mp3FrameInfo info;
+    auto const&  entries = index.entries();
+
+    return entries.size() > 2 && parseMp3FrameHeader(mp3.data(), info) && isTagPlaceholderFrame(mp3.data(), mp3.size(), info)
+        && entries[0].offset == static_cast<uint64_t>(info.size) && entries[0].samples == 0
+        && entries[1].samples == 10 * FRAME_SAMPLES;
+}
+
+
+// Info tag frame and 100 audio frames written in pieces, an entry every 10 frames;
+// argv[1] lame - the index of a stream lame encodes
+int main(int argNum, char** args)
+{
+    if (argNum > 1)
+        return std::string(args[1]) == "lame" && checkLameIndex() ? 0 : -1;
+
+    auto const frame = makeSilentMp3Frame(44100, 2);
+    auto       tag   = frame;
+    ::memcpy(tag.data() + 4 + 32, "Info", 4);
+
+    std::vector<uint8_t> stream(tag);
+    for (int32_t idx = 0; idx < 100; ++idx)
+        stream.insert(stream.end(), frame.begin(), frame.end());
+
+    SeekIndexBuilder index(10);
+    for (size_t first = 0; first < stream.size(); first += 333)
+        index.add(stream.data() + first, std::min<size_t>(333, stream.size() - first));
+
+    auto const& entries = index.entries();
+    if (entries.size() != 10)
+        return -1;
+
+    for (size_t idx = 0; idx < entries.size(); ++idx)
+        if (entries[idx].offset != (1 + 10 * idx) * frame.size() || entries[idx].samples != 10 * 1152 * idx)
+            return -1;
+
+    std::string const fileName = "test_seekindex.seek";
+    if (!index.write(fileName))
+        return -1;
+
+    std::ifstream file(fileName, std::ios_base::binary);
+    char header[20] = { 0, };
+    file.read(header, sizeof(header));
+    file.seekg(0, std::ios_base::end);
+    auto const size = static_cast<size_t>(file.tellg());
+    file.close();
+    ::remove(fileName.c_str());
+
+    return ::memcmp(header, "E2SK\1\0\0\0\x44\xac\0\0\x0a\0\0\0\x0a\0\0\0", sizeof(header)) == 0 && size == 20 + 10 * 16 ? 0 : -1;
+}
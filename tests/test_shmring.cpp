@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "shmring.hpp"
+
+static const int32_t CHANNELS   = 2;
+static const int32_t FRAME_NUM  = 200003;
+
+static int16_t sampleAt(int32_t idx)
+{
+    return static_cast<int16_t>(idx * 7 + 3);
+}
+
+static void* produce(void* arg)
+{
+    auto& ring = *static_cast<ShmRing*>(arg);
+    std::vector<int16_t> chunk;
+
+    for (int32_t frame = 0, size = 1; frame < FRAME_NUM; frame += size, size = size * 5 % 3001 + 1) {
+        size = std::min(size, FRAME_NUM - frame);
+        chunk.resize(size * CHANNELS);
+
+        for (int32_t idx = 0; idx < size * CHANNELS; ++idx)
+            chunk[idx] = sampleAt(frame * CHANNELS + idx);
+
+        ring.write(chunk.data(), size);
+    }
+
+    ring.close();
+    return nullptr;
+}
+
+// a ring whose header says it holds capacity bytes must be refused
+// unless that is a non-zero number of whole frames
+static bool isOpened(uint64_t capacity)
+{
+    std::string error;
+    ShmRing     producer;
+
+    if (!producer.create("", 44100, CHANNELS, 16, error))
+        return true;
+
+    void* addr = ::mmap(nullptr, sizeof(ShmRingHeader), PROT_READ | PROT_WRITE, MAP_SHARED, producer.fd(), 0);
+    if (addr == MAP_FAILED)
+        return true;
+
+    static_cast<ShmRingHeader*>(addr)->capacity = capacity;
+    ::munmap(addr, sizeof(ShmRingHeader));
+
+    ShmRing consumer;
+    return consumer.open("#" + std::to_string(producer.fd()), error);
+}
+
+// a producer thread pushes a known pattern through a ring smaller than the
+// stream, the consumer must see it complete and in order
+int main()
+{
+    std::string error;
+    auto const name = "/encode2mp3-test-" + std::to_string(::getpid());
+    ShmRing producer;
+
+    if (!producer.create(name, 44100, CHANNELS, 4096, error))
+        return -1;
+
+    ShmRing consumer;
+    if (!consumer.open(name, error) || consumer.channels() != CHANNELS || consumer.sampleRate() != 44100)
+        return -1;
+
+    pthread_t thread;
+    if (::pthread_create(&thread, nullptr, &produce, &producer) != 0)
+        return -1;
+
+    int32_t        frame = 0;
+    int16_t const* data  = nullptr;
+    bool           isOk  = true;
+
+    while (auto const got = consumer.acquire(data, 1000)) {
+        for (int32_t idx = 0; idx < got * CHANNELS; ++idx)
+            isOk = isOk && data[idx] == sampleAt(frame * CHANNELS + idx);
+
+        frame += got;
+        consumer.release(got);
+    }
+
+    ::pthread_join(thread, nullptr);
+    isOk = isOk && isOpened(16 * CHANNELS * sizeof(int16_t)) && !isOpened(0) && !isOpened(CHANNELS * sizeof(int16_t) + 1);
+    return isOk && frame == FRAME_NUM ? 0 : -1;
+}
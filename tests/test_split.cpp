@@ -0,0 +1,161 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "encoder.hpp"
+#include "mp3frame.hpp"
+#include "split.hpp"
+
+// pieces of files of different lengths cover every frame once; frames "encoded"
+// from each piece carry their position in the file, trimmed and joined they
+// have to come out in order with nothing missing or repeated
+static bool checkSplit(int64_t samples, int32_t pieceNum)
+{
+    const constexpr int32_t FRAME_SAMPLES = 1152;
+
+    auto const pieces = planSplit(samples, FRAME_SAMPLES, pieceNum);
+    auto const frame  = makeSilentMp3Frame(44100, 2);
+
+    if (pieces.empty() || static_cast<int32_t>(pieces.size()) > pieceNum || pieces.back().readEnd != samples)
+        return false;
+
+    std::vector<uint8_t> joined;
+
+    for (auto const& piece : pieces) {
+        if (piece.readFirst % FRAME_SAMPLES != 0 || piece.readFirst > piece.readEnd)
+            return false;
+
+        std::vector<uint8_t> mp3;
+        auto const frameNum = (piece.readEnd - piece.readFirst + FRAME_SAMPLES - 1) / FRAME_SAMPLES + 1; // + flush
+
+        for (int64_t idx = 0; idx < frameNum; ++idx) {
+            mp3.insert(mp3.end(), frame.begin(), frame.end());
+            mp3.back() = static_cast<uint8_t>(piece.readFirst / FRAME_SAMPLES + idx);
+        }
+
+        auto const trimmed = trimFrames(mp3, piece.dropFrames, piece.keepFrames);
+        joined.insert(joined.end(), trimmed.begin(), trimmed.end());
+    }
+
+    auto const frameNum = (samples + FRAME_SAMPLES - 1) / FRAME_SAMPLES + 1;
+    if (joined.size() != frameNum * frame.size())
+        return false;
+
+    for (int64_t idx = 0; idx < frameNum; ++idx)
+        if (joined[(idx + 1) * frame.size() - 1] != static_cast<uint8_t>(idx))
+            return false;
+
+    return true;
+}
+
+
+// MP3 of stereo frames readFirst .. readEnd of a tone sweep from lame, as the
+// whole file or as a piece of it
+static std::vector<uint8_t> encodeSweep(int64_t readFirst, int64_t readEnd, bool isPiece)
+{
+    const constexpr int32_t SAMPLE_RATE = 44100;
+    const constexpr int32_t BLOCK       = 4096;
+    const constexpr double  TWO_PI      = 2 * 3.14159265358979;
+
+    EncoderSettings settings;
+    settings.inSampleRate = SAMPLE_RATE;
+    settings.bitrate      = 128;
+    settings.isPiece      = isPiece;
+
+    std::string error;
+    auto const  encoder = makeEncoder(EncoderKind::Lame, settings, error);
+
+    if (!encoder)
+        return {};
+
+    std::vector<int16_t> pcm(BLOCK * 2);
+    std::vector<uint8_t> buffer(BLOCK * 2 + 7200);
+    std::vector<uint8_t> mp3;
+
+    for (int64_t first = readFirst; first < readEnd; first += BLOCK) {
+        auto const frames = static_cast<int32_t>(std::min<int64_t>(BLOCK, readEnd - first));
+
+        for (int32_t frame = 0; frame < frames; ++frame) {
+            auto const time = static_cast<double>(first + frame) / SAMPLE_RATE;
+            pcm[frame * 2]     = static_cast<int16_t>(8000 * ::sin(TWO_PI * (200 + 400 * time) * time));
+            pcm[frame * 2 + 1] = static_cast<int16_t>(6000 * ::sin(TWO_PI * 330 * time));
+        }
+
+        auto const size = encoder->encode(pcm.data(), frames, buffer.data(), static_cast<int32_t>(buffer.size()));
+        if (size < 0)
+            return {};
+        mp3.insert(mp3.end(), buffer.begin(), buffer.begin() + size);
+    }
+
+    auto const size = encoder->flush(buffer.data(), static_cast<int32_t>(buffer.size()));
+    if (size < 0)
+        return {};
+    mp3.insert(mp3.end(), buffer.begin(), buffer.begin() + size);
+
+    if (!isPiece && encoder->tag(buffer.data(), buffer.size()) > 0) // players skip the tag frame, so the count does
+        mp3 = trimFrames(mp3, 1, -1);
+    return mp3;
+}
+
+
+// frames and their samples in mp3, false if there are none
+static bool countFrames(std::vector<uint8_t> const& mp3, int64_t& frames, int64_t& samples)
+{
+    Mp3FrameSplitter splitter;
+    uint8_t const*   frame = nullptr;
+    Mp3FrameInfo     info;
+
+    splitter.add(mp3.data(), mp3.size());
+    frames  = 0;
+    samples = 0;
+
+    for (; splitter.next(frame, info); ++frames)
+        samples += info.samples;
+
+    return frames > 0;
+}
+
+
+// pieces encoded by lame and joined as --split does have as many frames and
+// as long a duration as the whole file encoded at once
+static bool checkEncodedSplit(int64_t samples, int32_t pieceNum)
+{
+    const constexpr int32_t FRAME_SAMPLES = 1152; // MPEG-1 at 44.1 kHz
+
+    auto const           whole = encodeSweep(0, samples, false);
+    std::vector<uint8_t> joined;
+
+    for (auto const& piece : planSplit(samples, FRAME_SAMPLES, pieceNum)) {
+        auto const trimmed = trimFrames(encodeSweep(piece.readFirst, piece.readEnd, true), piece.dropFrames, piece.keepFrames);
+        joined.insert(joined.end(), trimmed.begin(), trimmed.end());
+    }
+
+    int64_t wholeFrames   = 0;
+    int64_t wholeSamples  = 0;
+    int64_t joinedFrames  = 0;
+    int64_t joinedSamples = 0;
+
+    return countFrames(whole, wholeFrames, wholeSamples) && countFrames(joined, joinedFrames, joinedSamples)
+        && joinedFrames == wholeFrames && joinedSamples == wholeSamples;
+}
+
+
+// argv[1] pieces of frame counting fakes; with "lame" after it, of real
+// encoder output compared with the whole file encoded at once
+int main(int argNum, char** args)
+{
+    if (argNum != 2 && argNum != 3)
+        return -1;
+
+    auto const pieceNum = ::atoi(args[1]);
+
+    if (argNum == 3)
+        return ::strcmp(args[2], "lame") == 0 && checkEncodedSplit(1152 * 300 + 77, pieceNum)
+            && checkEncodedSplit(44100 * 20, pieceNum) ? 0 : -1;
+
+    for (int64_t samples : { 0, 1000, 1152 * 63, 1152 * 500, 1152 * 500 + 7, 44100 * 60 })
+        if (!checkSplit(samples, pieceNum))
+            return -1;
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include <chrono>
+
+#include "throttle.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// 1000 tokens per second with 100 tokens burst
+int main()
+{
+    TokenBucket bucket(1000, 100);
+    auto start = Clock::now();
+
+    if (bucket.acquire(100) != 0 || secondsSince(start) > 0.05) // burst is free
+        return -1;
+
+    start = Clock::now();
+    auto const wait = bucket.acquire(200); // 200 in debt, paid in ~0.2s
+
+    if (wait < 0.15 || wait > 0.25 || secondsSince(start) < 0.15)
+        return -1;
+
+    if (bucket.throttledSeconds() != wait)
+        return -1;
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <string>
+
+#include "tuner.hpp"
+
+// throughput rising by 10 per worker up to peak, falling by 10 per worker after it
+static double rateAt(size_t workers, size_t peak)
+{
+    return workers <= peak ? 10.0 * workers : 10.0 * peak - 10.0 * (workers - peak);
+}
+
+// workers after 100 intervals all stay within [low, high] over the last 50
+static bool settles(ConcurrencyTuner& tuner, size_t peak, double ioWait, size_t low, size_t high)
+{
+    for (int32_t interval = 0; interval < 100; ++interval) {
+        auto const workers = tuner.next(peak > 0 ? rateAt(tuner.workers(), peak) : 100.0, ioWait);
+
+        if (interval >= 50 && (workers < low || workers > high))
+            return false;
+    }
+
+    return true;
+}
+
+
+int main(int argNum, char** args)
+{
+    if (argNum != 2)
+        return -1;
+
+    std::string const test = args[1];
+
+    if (test == "peak") { // climbs from 4 to the peak and probes around it
+        ConcurrencyTuner tuner(1, 32, 4);
+        return settles(tuner, 12, 0, 11, 13) ? 0 : -1;
+    }
+
+    if (test == "contended") { // starts above the peak, comes down
+        ConcurrencyTuner tuner(1, 32, 16);
+        return settles(tuner, 3, 0, 2, 4) ? 0 : -1;
+    }
+
+    if (test == "bounds") { // peak above the upper bound
+        ConcurrencyTuner tuner(2, 8, 4);
+        return settles(tuner, 40, 0, 7, 8) ? 0 : -1;
+    }
+
+    if (test == "io") { // no gain from workers, but waiting on I/O: up to the bound
+        ConcurrencyTuner tuner(1, 24, 8);
+        return settles(tuner, 0, 0.5, 23, 24) ? 0 : -1;
+    }
+
+    if (test == "flat") { // no gain, no I/O wait: stays around the start
+        ConcurrencyTuner tuner(1, 24, 8);
+        return settles(tuner, 0, 0, 7, 9) ? 0 : -1;
+    }
+
+    return -1;
+}
@@ -0,0 +1,44 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "watch.hpp"
+
+// a writer thread appends to a file, closes it and the watch has to see both
+int main()
+{
+    std::string const fileName = "test_watch.tmp";
+    auto file = ::fopen(fileName.c_str(), "wb");
+
+    if (!file)
+        return -1;
+
+    FileWatch watch;
+    watch.open(fileName);
+
+    if (watch.wait(0.05) != FileWatch::Event::Timeout)
+        return -1;
+
+    std::thread writer([file]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ::fwrite("RIFF", 1, 4, file);
+        ::fflush(file);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ::fclose(file);
+    });
+
+    auto const grown  = watch.wait(2);
+    auto       closed = grown;
+
+    for (int32_t idx = 0; idx < 10 && closed != FileWatch::Event::Closed; ++idx)
+        closed = watch.wait(0.2);
+
+    writer.join();
+    ::remove(fileName.c_str());
+
+    if (grown == FileWatch::Event::Timeout)
+        return -1;
+
+    return !watch.canSeeClose() || closed == FileWatch::Event::Closed ? 0 : -1;
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include "throttle.hpp"
+
+using std::unique_ptr;
+
+
+TokenBucket::TokenBucket(double rate, double burst)
+    : rate    (rate)
+    , burst   (burst)
+    , tokens  (burst) // start full, short jobs don't wait at all
+    , refilled(Clock::now())
+{}
+
+
+TokenBucket::~TokenBucket()
+{
+    ::pthread_mutex_destroy(&mtx);
+}
+
+
+double TokenBucket::acquire(double toTake)
+{
+    ::pthread_mutex_lock(&mtx);
+
+    auto const now = Clock::now();
+    tokens   = std::min(burst, tokens + rate * std::chrono::duration<double>(now - refilled).count());
+    refilled = now;
+    tokens  -= toTake;
+
+    auto const wait = tokens < 0 ? -tokens / rate : 0.0; // later takers queue up behind the debt
+    throttled += wait;
+
+    ::pthread_mutex_unlock(&mtx);
+
+    if (wait > 0)
+        std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+
+    return wait;
+}
+
+
+double TokenBucket::throttledSeconds() const
+{
+    ::pthread_mutex_lock(&mtx);
+    auto const seconds = throttled;
+    ::pthread_mutex_unlock(&mtx);
+    return seconds;
+}
+
+
+static unique_ptr<TokenBucket> readBucket;
+static unique_ptr<TokenBucket> writeBucket;
+static unique_ptr<TokenBucket> iopsBucket;
+static double                  readIopsWait  = 0; // iops bucket wait split by operation
+static double                  writeIopsWait = 0;
+static pthread_mutex_t         iopsWaitMtx   = PTHREAD_MUTEX_INITIALIZER;
+
+
+static unique_ptr<TokenBucket> makeBucket(double rate, double burstSeconds, double minBurst)
+{
+    if (rate <= 0)
+        return nullptr;
+
+    return unique_ptr<TokenBucket>(new TokenBucket(rate, std::max(rate * burstSeconds, minBurst)));
+}
+
+
+// has to be called before workers start
+void setIoLimits(double readBytesPerSec, double writeBytesPerSec, double iops, double burstSeconds)
+{
+    readBucket  = makeBucket(readBytesPerSec,  burstSeconds, 0);
+    writeBucket = makeBucket(writeBytesPerSec, burstSeconds, 0);
+    iopsBucket  = makeBucket(iops,             burstSeconds, 1);
+}
+
+
+static void throttle(TokenBucket* bucket, size_t bytes, double& iopsWait)
+{
+    if (iopsBucket) {
+        auto const wait = iopsBucket->acquire(1);
+        ::pthread_mutex_lock(&iopsWaitMtx);
+        iopsWait += wait;
+        ::pthread_mutex_unlock(&iopsWaitMtx);
+    }
+
+    if (bucket)
+        bucket->acquire(static_cast<double>(bytes));
+}
+
+
+void throttleRead(size_t bytes)
+{
+    throttle(readBucket.get(), bytes, readIopsWait);
+}
+
+
+void throttleWrite(size_t bytes)
+{
+    throttle(writeBucket.get(), bytes, writeIopsWait);
+}
+
+
+bool isIoLimited()
+{
+    return readBucket || writeBucket || iopsBucket;
+}
+
+
+double readThrottledSeconds()
+{
+    ::pthread_mutex_lock(&iopsWaitMtx);
+    auto const iopsWait = readIopsWait;
+    ::pthread_mutex_unlock(&iopsWaitMtx);
+    return iopsWait + (readBucket ? readBucket->throttledSeconds() : 0);
+}
+
+
+double writeThrottledSeconds()
+{
+    ::pthread_mutex_lock(&iopsWaitMtx);
+    auto const iopsWait = writeIopsWait;
+    ::pthread_mutex_unlock(&iopsWaitMtx);
+    return iopsWait + (writeBucket ? writeBucket->throttledSeconds() : 0);
+}
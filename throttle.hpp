@@ -0,0 +1,43 @@
+#ifndef THROTTLE_H
+#define THROTTLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <pthread.h>
+
+// token bucket shared by threads: tokens refill at rate per second up to burst,
+// a taker may go into debt and then sleeps until the debt is paid off,
+// so requests bigger than burst still pass at the configured rate
+class TokenBucket
+{
+public:
+    TokenBucket(double rate, double burst);
+    ~TokenBucket();
+
+    TokenBucket(TokenBucket const&) = delete;
+    TokenBucket& operator=(TokenBucket const&) = delete;
+
+    double acquire(double tokens); // returns seconds the caller was put to sleep
+    double throttledSeconds() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    double            rate;
+    double            burst;
+    double            tokens;
+    Clock::time_point refilled;
+    double            throttled = 0;
+    mutable pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+};
+
+// process wide limits for all workers, rates of 0 mean unlimited
+void   setIoLimits(double readBytesPerSec, double writeBytesPerSec, double iops, double burstSeconds);
+void   throttleRead(size_t bytes);  // call before every read from an input
+void   throttleWrite(size_t bytes); // call before every write to an output
+bool   isIoLimited();
+double readThrottledSeconds();
+double writeThrottledSeconds();
+
+#endif // THROTTLE_H
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#include "tuner.hpp"
+
+static const constexpr double  NOISE          = 0.05; // rate changes within 5% count as flat
+static const constexpr double  IO_BOUND       = 0.2;  // iowait share of a host waiting on storage
+static const constexpr int32_t HOLD_INTERVALS = 5;
+
+
+ConcurrencyTuner::ConcurrencyTuner(size_t minWorkers, size_t maxWorkers, size_t startWorkers)
+    : minWorkers(std::max<size_t>(1, minWorkers))
+    , maxWorkers(std::max(this->minWorkers, maxWorkers))
+    , current   (std::min(std::max(startWorkers, this->minWorkers), this->maxWorkers))
+{}
+
+
+size_t ConcurrencyTuner::next(double rate, double ioWait)
+{
+    auto const prev = prevRate;
+    prevRate = rate;
+
+    if (hold > 0) {
+        if (--hold > 0) {
+            why = "hold";
+            return current;
+        }
+        return step("probe");
+    }
+
+    if (prev <= 0)
+        return step("probe");
+
+    auto const gain = rate / prev - 1;
+
+    if (gain < -NOISE) {
+        direction = -direction;
+        hold      = HOLD_INTERVALS;
+        return step("slower, back");
+    }
+
+    if (gain > NOISE)
+        return step("faster, on");
+
+    if (ioWait > IO_BOUND) {
+        direction = 1;
+        return step("flat, waiting on I/O");
+    }
+
+    direction = -direction; // the last step bought nothing
+    hold      = HOLD_INTERVALS;
+    return step("flat, back");
+}
+
+
+// one worker in the current direction, at a bound turn around and hold
+size_t ConcurrencyTuner::step(char const* reason)
+{
+    auto const target = direction > 0 ? std::min(current + 1, maxWorkers) : std::max(current - 1, minWorkers);
+
+    why = reason;
+
+    if (target == current) {
+        direction = -direction;
+        hold      = HOLD_INTERVALS;
+        why       = "at bound, hold";
+    }
+
+    current = target;
+    return current;
+}
+
+
+bool sampleCpuTimes(uint64_t& ioWait, uint64_t& total)
+{
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+    std::ifstream stat("/proc/stat");
+    std::string   cpu;
+    uint64_t      value = 0;
+
+    if (!(stat >> cpu) || cpu != "cpu")
+        return false;
+
+    ioWait = total = 0;
+
+    for (int32_t field = 0; field < 8 && stat >> value; ++field) { // user nice system idle iowait irq softirq steal
+        total += value;
+        if (field == 4)
+            ioWait = value;
+    }
+
+    return total > 0;
+#else
+    (void)ioWait;
+    (void)total;
+    return false;
+#endif
+}
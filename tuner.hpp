@@ -0,0 +1,40 @@
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// hill climbing on measured throughput for the number of active workers:
+// keep stepping while it gets faster, step back and hold for a while when
+// it gets slower or no faster, and probe again after the hold; while the
+// host waits on I/O (network storage) a step that bought nothing goes on up
+class ConcurrencyTuner
+{
+public:
+    ConcurrencyTuner(size_t minWorkers, size_t maxWorkers, size_t startWorkers);
+
+    // workers for the next interval from the throughput of the last one (any
+    // unit per second) and the share of CPU time spent waiting on I/O, 0..1
+    size_t next(double rate, double ioWait);
+
+    size_t      workers() const { return current; }
+    char const* reason() const  { return why; } // of the last decision
+
+private:
+    size_t step(char const* reason);
+
+    size_t      minWorkers;
+    size_t      maxWorkers;
+    size_t      current;
+    int32_t     direction = 1;
+    int32_t     hold      = 0; // intervals left without a change
+    double      prevRate  = 0;
+    char const* why       = "start";
+};
+
+// CPU time counters of the whole host, false where they aren't available;
+// iowait share between two samples is (ioWait2 - ioWait1) / (total2 - total1)
+bool sampleCpuTimes(uint64_t& ioWait, uint64_t& total);
+
+#endif // TUNER_H
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <thread>
+#include <sys/stat.h>
+
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "watch.hpp"
+
+static const constexpr double POLL_STEP = 0.1; // seconds between size checks without inotify
+
+
+static int64_t fileSize(std::string const& name)
+{
+    struct stat s;
+    return ::stat(name.c_str(), &s) == 0 ? static_cast<int64_t>(s.st_size) : -1;
+}
+
+
+FileWatch::~FileWatch()
+{
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+    if (fd >= 0)
+        ::close(fd);
+#endif
+}
+
+
+void FileWatch::open(std::string const& fileName)
+{
+    name = fileName;
+    size = fileSize(name);
+
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+    fd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+
+    if (fd >= 0 && ::inotify_add_watch(fd, name.c_str(), IN_MODIFY | IN_CLOSE_WRITE) < 0) { // out of watches
+        ::close(fd);
+        fd = -1;
+    }
+#endif
+}
+
+
+FileWatch::Event FileWatch::wait(double seconds)
+{
+#if defined (__linux__) || defined (__linux) || defined (__gnu_linux__)
+    if (fd >= 0) {
+        pollfd pfd = { fd, POLLIN, 0 };
+
+        if (::poll(&pfd, 1, static_cast<int>(seconds * 1000)) <= 0)
+            return Event::Timeout;
+
+        alignas(inotify_event) char events[4096];
+        auto    result = Event::Changed;
+        ssize_t got    = 0;
+
+        while ((got = ::read(fd, events, sizeof(events))) > 0) // drain, several writes come as several events
+            for (auto pos = events; pos < events + got; pos += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(pos)->len)
+                if (reinterpret_cast<inotify_event*>(pos)->mask & IN_CLOSE_WRITE)
+                    result = Event::Closed;
+
+        return result;
+    }
+#endif
+
+    for (double waited = 0; waited < seconds; waited += POLL_STEP) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(POLL_STEP));
+        auto const newSize = fileSize(name);
+
+        if (newSize != size) {
+            size = newSize;
+            return Event::Changed;
+        }
+    }
+
+    return Event::Timeout;
+}
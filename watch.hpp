@@ -0,0 +1,32 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stdint.h>
+#include <string>
+
+// waits for a file another process writes to to grow or to be closed,
+// inotify on Linux, polling the size elsewhere or if inotify fails
+class FileWatch
+{
+public:
+    enum class Event : uint8_t { Changed, Closed, Timeout };
+
+    FileWatch() = default;
+    FileWatch(FileWatch const&) = delete;
+    FileWatch& operator=(FileWatch const&) = delete;
+    ~FileWatch();
+
+    void open(std::string const& fileName);
+
+    // wait up to seconds for the writer, Closed only comes from inotify
+    Event wait(double seconds);
+
+    bool canSeeClose() const { return fd >= 0; }
+
+private:
+    std::string name;
+    int         fd   = -1; // inotify instance, -1 - polling
+    int64_t     size = -1; // last size seen when polling
+};
+
+#endif // WATCH_H